@@ -0,0 +1,90 @@
+#ifndef UTIL_SLOTMAP_H
+#define UTIL_SLOTMAP_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace vkcl::util {
+
+	// Refers to an element of a SlotMap, it goes stale once the element is removed even if the slot is reused
+	struct SlotHandle {
+		uint32_t index;
+		uint32_t generation;
+	};
+
+	// Elements live in slots that are recycled but never move, so pointers to them stay valid memory
+	// for as long as the map exists. Insert, Remove and Get are O(1).
+	template <typename T>
+	class SlotMap {
+	public:
+		SlotMap() : count(0) { }
+
+		T *Insert(SlotHandle &handle)
+		{
+			uint32_t index;
+			if (!freeslots.empty()) {
+				index = freeslots.back();
+				freeslots.pop_back();
+			} else {
+				index = slots.size();
+				slots.push_back({});
+			}
+
+			Slot &slot = slots[index];
+			slot.value = T();
+			slot.live = true;
+			handle = { index, slot.generation };
+			count++;
+
+			return &slot.value;
+		}
+
+		bool Remove(SlotHandle handle) // false if handle is stale
+		{
+			if (!Get(handle))
+				return false;
+
+			Slot &slot = slots[handle.index];
+			slot.live = false;
+			slot.generation++;
+			freeslots.push_back(handle.index);
+			count--;
+
+			return true;
+		}
+
+		T *Get(SlotHandle handle) // nullptr if handle is stale
+		{
+			if (handle.index >= slots.size())
+				return nullptr;
+
+			Slot &slot = slots[handle.index];
+			return (slot.live && slot.generation == handle.generation) ? &slot.value : nullptr;
+		}
+
+		template <typename F>
+		void ForEach(F f) // f may remove the element it is given
+		{
+			for (size_t i = 0; i < slots.size(); i++) {
+				if (slots[i].live)
+					f(&slots[i].value);
+			}
+		}
+
+		inline size_t size() { return count; }
+	protected:
+		struct Slot {
+			T value;
+			uint32_t generation;
+			bool live;
+		};
+
+		std::deque<Slot> slots; // a deque never moves its elements when it grows
+		std::vector<uint32_t> freeslots;
+		size_t count;
+	};
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef VK_DESCRIPTOR_H
+#define VK_DESCRIPTOR_H
+
+#include <vkcl/volk.h>
+
+#include "util_exception.h"
+#include "vk_reflect.h"
+#include "vk_sync.h"
+
+#include <deque>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace vkcl {
+
+	const uint32_t DescriptorPoolSets = 64;
+	const size_t DescriptorCacheSize = 1024;
+
+	struct DescriptorSet {
+		VkDescriptorSet handle;
+		uint32_t pool; // index of the pool handle came from
+	};
+
+	// Hands out descriptor sets from a growing list of shared pools. A pool is reset as a whole once every set
+	// taken from it has been released and the submissions using them have completed.
+	class DescriptorAllocator {
+	public:
+		DescriptorAllocator() { }
+
+		void Load(VkDevice device, FencePool *fences);
+		void Delete();
+
+		DescriptorSet Allocate(VkDescriptorSetLayout layout, const std::vector<ShaderBinding> &bindings);
+		void Release(DescriptorSet set, const SubmissionList &submissions); // set is dead once submissions have completed
+	protected:
+		struct Pool {
+			VkDescriptorPool pool;
+			uint32_t live; // sets allocated and not retired yet
+		};
+
+		struct Retired {
+			SubmissionList submissions;
+			uint32_t pool;
+		};
+
+		VkDevice device;
+		FencePool *fences;
+
+		std::vector<Pool> pools;
+		std::vector<uint32_t> free; // pools that were reset and can become current again
+		uint32_t current; // pool new sets come from
+		std::deque<Retired> retired; // in release order
+
+		uint32_t CreatePool(const std::vector<ShaderBinding> &bindings);
+		void Retire();
+	};
+
+	struct DescriptorKey {
+		VkDescriptorSetLayout layout;
+		std::vector<VkDescriptorBufferInfo> buffers; // one per binding
+
+		bool operator==(const DescriptorKey &other) const;
+	};
+
+	struct DescriptorKeyHash {
+		size_t operator()(const DescriptorKey &key) const;
+	};
+
+	// A written descriptor set, never updated again so it can be bound by any number of submissions
+	struct DescriptorEntry {
+		DescriptorKey key;
+		DescriptorSet set;
+		uint32_t refs; // shaders and command lists holding the set
+		SubmissionList lastuse; // submissions that may still be using the set
+		bool stale; // one of its buffers was deleted, freed once nothing holds it
+		std::list<DescriptorEntry *>::iterator lru;
+	};
+
+	// Maps a layout and the buffers bound to it to a set that already holds them, so rebinding the same buffers is free
+	class DescriptorCache {
+	public:
+		DescriptorCache() { }
+
+		void Load(VkDevice device, DescriptorAllocator *allocator, FencePool *fences, size_t capacity);
+		void Delete();
+
+		DescriptorEntry *Acquire(VkDescriptorSetLayout layout, const std::vector<ShaderBinding> &bindings, const std::vector<VkDescriptorBufferInfo> &buffers, VkDescriptorUpdateTemplate update = VK_NULL_HANDLE);
+		void Release(DescriptorEntry *entry);
+		inline void Retain(DescriptorEntry *entry) { entry->refs++; }
+		inline void Use(DescriptorEntry *entry, Submission submission) { fences->Track(entry->lastuse, submission); }
+		void Invalidate(VkBuffer buffer, VkDeviceSize offset); // drops every set that references the range of buffer starting at offset
+	protected:
+		VkDevice device;
+		DescriptorAllocator *allocator;
+		FencePool *fences;
+		size_t capacity; // sets nobody holds are evicted beyond this
+
+		std::unordered_map<DescriptorKey, DescriptorEntry *, DescriptorKeyHash> entries;
+		std::list<DescriptorEntry *> lru; // most recently acquired first
+		std::multimap<std::pair<VkBuffer, VkDeviceSize>, DescriptorEntry *> users; // cached sets by the buffer ranges they reference
+
+		void Unlink(DescriptorEntry *entry); // takes entry out of the cache, it can't be acquired or invalidated anymore
+		void Free(DescriptorEntry *entry);
+		void Evict();
+	};
+
+}
+
+#endif
@@ -1,98 +1,334 @@
-#ifndef VK_DEVICE_H
-#define VK_DEVICE_H
-
-#include <vkcl/volk.h>
-
-#include "util_exception.h"
-#include "util_logging.h"
-#include "vk_instance.h"
-#include "vk_memory.h"
-
-#include <vector>
-#include <string>
-
-namespace vkcl {
-
-	std::vector<VkPhysicalDevice> QueryPhysicalDevices(VkInstance instance);
-
-	struct Buffer {
-		VkBuffer devbuffer;
-		VmaAllocation devalloc;
-		VmaAllocationInfo devinfo;
-	};
-
-	struct Shader {
-		size_t BufferCount;
-		VkCommandBuffer commandbuffer;
-		VkShaderModule shadermod;
-		VkPipeline pipeline;
-		VkPipelineLayout pipelinelayout;
-		VkDescriptorPool pool;
-		VkDescriptorSet set;
-		VkDescriptorSetLayout layout;
-		VkFence fence;
-	};
-
-	class Device {
-	public:
-		Device() { }
-		Device(const Device &dev);
-		Device(VkInstance instance, VkPhysicalDevice PhysicalDevice);
-		void Delete();
-
-		void Load(const Device &dev);
-		void Load(VkInstance instance, VkPhysicalDevice PhysicalDevice);
-		uint32_t MemoryType(uint32_t Type, VkMemoryPropertyFlags Props);
-
-		// Buffer Operations
-		Buffer *CreateBuffer(VkDeviceSize size);
-		void  DeleteBuffer(Buffer *buffer);
-		void  UploadData(Buffer *buffer, void *data);
-		void *DownloadData(Buffer *buffer);
-		void  ReleaseData(void *data);
-
-		// Compute Operations
-		Shader *CreateShader(const std::string fp, size_t BufferCount);
-		void DeleteShader(Shader *shader);
-		void BindBuffers(Shader *shader, Buffer **buffers);
-		void RunShader(Shader *shader, uint32_t x, uint32_t y, uint32_t z);
-
-		inline void setId(uint32_t id) { this->id = id; }
-		inline uint32_t getId() { return id; }
-		inline std::string getName() { return PhysicalDeviceProps.deviceName; }
-
-		inline VkDevice get() { return device; }
-		inline VkQueue getComputeQueue() { return ComputeQueue; }
-		inline VkQueue getTransferQueue() { return TransferQueue; }
-		inline VkPhysicalDeviceProperties getProps() { return PhysicalDeviceProps; }
-		inline VkPhysicalDevice getPhysicalDev() { return PhysicalDevice; }
-		inline VkCommandPool getShortCommandPool() { return Pool_ShortLived; } // Command pool for short lived command buffers
-		inline VkCommandPool getCommandPool() { return Pool; }
-		inline uint32_t *getQueueFamilyIndices() { return QueueFamilyIndices; } // [0] = Compute, [1] = Transfer
-		inline VmaAllocator getAllocator() { return allocator; }
-
-		void operator=(const Device &devb);
-	protected:
-		VkPhysicalDevice PhysicalDevice;
-		VkPhysicalDeviceProperties PhysicalDeviceProps;
-		VkDevice device;
-		VkQueue ComputeQueue;
-		VkQueue TransferQueue;
-		VkCommandPool Pool_ShortLived;
-		VkCommandPool Pool;
-		uint32_t QueueFamilyIndices[2];
-		uint32_t id;
-
-		VmaAllocator allocator;
-
-		void CreateVKBuffer(VkDeviceSize size, VkBufferUsageFlags usageflags, VkMemoryPropertyFlags memflags, VkBuffer &buffer, VmaAllocation &allocation, VmaAllocationInfo *allocinfo);
-		void CopyVKBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size);
-
-		std::vector<Buffer *> buffers;
-	};
-
-	std::vector<vkcl::Device> QueryAllDevices();
-
-}
-
-#endif
+#ifndef VK_DEVICE_H
+#define VK_DEVICE_H
+
+#include <vkcl/volk.h>
+
+#include "util_exception.h"
+#include "util_logging.h"
+#include "util_slotmap.h"
+#include "vk_instance.h"
+#include "vk_descriptor.h"
+#include "vk_memory.h"
+#include "vk_pipeline.h"
+#include "vk_pool.h"
+#include "vk_staging.h"
+#include "vk_sync.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <string>
+#include <future>
+
+namespace vkcl {
+
+	std::vector<VkPhysicalDevice> QueryPhysicalDevices(VkInstance instance);
+
+	struct AliasGroup;
+
+	struct Buffer {
+		util::SlotHandle handle; // goes stale once the buffer is deleted, see Device::GetBuffer
+		VkBuffer devbuffer;
+		VmaAllocation devalloc;
+		VmaAllocationInfo devinfo; // of the whole allocation, which pooled buffers share
+		VkDeviceSize offset; // where the buffer starts in devbuffer
+		VkDeviceSize size;
+		uint32_t sizeclass; // BufferPool size class of the range, UINT32_MAX when devbuffer belongs to this buffer alone
+		bool transient; // range of the transient arena, see Device::CreateTransientBuffer
+		AliasGroup *group; // memory shared with buffers of other lifetimes, see Device::CreateAliasedBuffers
+		VkDeviceAddress address; // 0 unless the device supports buffer device addresses
+		void *mapped; // host pointer to the buffer, nullptr unless it is in host visible memory
+		VkDeviceMemory imported; // memory of the caller's allocation, see Device::ImportHostMemory
+		uint64_t transfer; // last staging span copying to or from this buffer
+		SubmissionList compute; // compute submissions that may still be using this buffer
+		AccessState state; // as of the last submitted compute work
+	};
+
+	// Allocation shared by a batch of aliased buffers. memory spans all of it and tracks the hazards of the
+	// whole group, since buffers with different lifetimes use the same bytes.
+	struct AliasGroup {
+		Buffer memory;
+		uint32_t refs; // buffers of the group that haven't been deleted yet
+	};
+
+	// A buffer of an aliased batch, used from step first up to and including step last
+	struct AliasedBufferDesc {
+		VkDeviceSize size;
+		uint32_t first;
+		uint32_t last;
+	};
+
+	// Where CreateBuffer places a buffer. Buffers in host visible memory are mapped for as long as they exist,
+	// UploadData and DownloadData copy straight to and from them.
+	enum class MemoryUsage {
+		GPUOnly, // device local, reached through the staging ring unless the device has zero copy memory
+		CPUToGPU, // host visible, written by the host and read by shaders
+		GPUToCPU, // host visible and preferably cached, written by shaders and read back by the host
+		Auto // host visible device local memory where the device has it in its main heap, GPUOnly otherwise
+	};
+
+	// What buffer creation does once a device local allocation would go over the memory budget
+	enum class BudgetPolicy {
+		FailFast, // throws right away
+		Evict, // frees memory cached for later buffers first, throws if that wasn't enough
+		Spill // frees cached memory first, places the buffer in host visible memory if that wasn't enough
+	};
+
+	struct HeapBudget {
+		VkDeviceSize budget; // how much this process can use, estimated without VK_EXT_memory_budget
+		VkDeviceSize usage; // used by this process, includes other devices and libraries with VK_EXT_memory_budget
+		VkDeviceSize allocated; // held by the buffers of this device
+		VkMemoryHeapFlags flags;
+	};
+
+	// Completion token of an asynchronous transfer, see Device::Wait and Device::Poll
+	struct Transfer {
+		uint64_t id;
+	};
+
+	struct RetiredCommands {
+		SubmissionList submissions;
+		VkCommandBuffer commandbuffer;
+	};
+
+	// Barriers against earlier work recorded for one submission of a shader, reused once it has completed
+	struct Prologue {
+		Submission submission;
+		VkCommandBuffer commandbuffer;
+	};
+
+	struct Shader {
+		size_t BufferCount;
+		uint32_t PushConstantSize;
+		uint32_t LocalSize[3]; // workgroup size, with specialization applied
+		std::vector<ShaderBinding> bindings; // what buffers[i] is bound to
+		std::vector<Buffer *> buffers; // currently bound buffers, followed by the ones given to UseBuffers
+		std::vector<VkDescriptorBufferInfo> bufferinfo; // what buffers are bound as, in binding order
+		VkCommandBuffer commandbuffer; // allocated on first submission
+		VkShaderModule shadermod;
+		VkPipeline pipeline;
+		VkPipelineLayout pipelinelayout;
+		DescriptorEntry *set; // cached set holding the bound buffers, nullptr until BindBuffers
+		VkDescriptorSetLayout layout;
+		ShaderVariant *variant; // owns shadermod, pipeline, pipelinelayout and layout
+		SubmissionList inflight; // submissions using the shader that may still be pending
+		uint32_t recorded[3]; // grid size commandbuffer was recorded with
+		std::vector<char> constants; // push constants commandbuffer was recorded with
+		bool dirty; // commandbuffer has to be re-recorded before its next submission
+		std::deque<RetiredCommands> retired; // replaced while still pending, freed once their submissions complete
+		std::vector<Prologue> prologues; // submitted ahead of commandbuffer when the bound buffers have hazards
+	};
+
+	struct ShaderDesc {
+		std::string fp;
+		size_t BufferCount; // 0 takes the bindings and push constant size from the SPIR-V
+		uint32_t PushConstantSize;
+		std::vector<SpecConstant> specialization;
+	};
+
+	struct StagingBlock {
+		VkBuffer buffer;
+		VmaAllocation alloc;
+		VmaAllocationInfo info;
+		VkDeviceSize size;
+		VkDeviceSize used;
+	};
+
+	struct Readback {
+		void *dst;
+		void *src;
+		VkDeviceSize size;
+	};
+
+	struct ListAccess {
+		Buffer *buffer;
+		AccessState state; // within the list
+		VkPipelineStageFlags firststage; // accesses up to the list's first write to the buffer,
+		VkAccessFlags firstaccess; // these are synchronized with work submitted before the list
+		bool written;
+	};
+
+	// Uploads, dispatches and downloads recorded into a single submission
+	struct CommandList {
+		VkCommandBuffer commandbuffer;
+		VkCommandBuffer prologue; // barriers against earlier submissions, recorded on submit
+		bool recording;
+		Submission inflight;
+		std::vector<StagingBlock> staging; // host memory the list's transfers go through, kept across submissions
+		std::vector<Readback> readbacks; // downloads copied out once the list has completed
+		std::vector<ListAccess> accesses; // every buffer the list uses
+		std::vector<Shader *> shaders; // every shader the list dispatches
+		std::vector<DescriptorEntry *> sets; // held by the recorded dispatches
+		BarrierBatch barriers; // barriers needed before the next recorded command
+	};
+
+	class Device {
+	public:
+		Device() { }
+		Device(const Device &dev);
+		Device(VkInstance instance, VkPhysicalDevice PhysicalDevice);
+		void Delete();
+
+		void Load(const Device &dev);
+		void Load(VkInstance instance, VkPhysicalDevice PhysicalDevice);
+		uint32_t MemoryType(uint32_t Type, VkMemoryPropertyFlags Props);
+
+		// Buffer Operations
+		Buffer *CreateBuffer(VkDeviceSize size, MemoryUsage usage = MemoryUsage::GPUOnly);
+		void  DeleteBuffer(Buffer *buffer); // buffer must not be used again, its slot goes to the next buffer created
+		Buffer *GetBuffer(util::SlotHandle handle); // nullptr once the buffer has been deleted
+		void  UploadData(Buffer *buffer, void *data);
+		void *DownloadData(Buffer *buffer);
+		void  ReleaseData(void *data);
+		void  SetStagingSize(VkDeviceSize size); // Resizes the staging ring used by UploadData and DownloadData
+		void *Map(Buffer *buffer); // waits for the work using buffer and returns its mapping, nullptr if it isn't host visible
+		void  Unmap(Buffer *buffer); // makes what the host wrote through Map visible to the work submitted next
+
+		// Host Memory
+		// Wraps memory the caller allocated in a buffer, data and size have to be multiples of getHostImportAlignment.
+		// The buffer can be bound like any other, and UploadData and DownloadData copy straight from and to data when
+		// it lies within an imported buffer. It has to be deleted before data is freed.
+		Buffer *ImportHostMemory(void *data, VkDeviceSize size);
+		VkDeviceAddress BufferAddress(Buffer *buffer); // for shaders that take buffers as GL_EXT_buffer_reference pointers
+
+		// Transient Buffers
+		// Bump allocated from the current epoch's region of an arena. NextEpoch starts a new epoch, the buffers of the
+		// epoch that used its region before are deleted as soon as the work using them has completed. Epochs that
+		// outgrow their region fall back to regular buffers, which are deleted along with the epoch all the same.
+		Buffer *CreateTransientBuffer(VkDeviceSize size);
+		void NextEpoch();
+		void SetTransientSize(VkDeviceSize size, uint32_t epochs = ArenaDefaultEpochs); // size of each epoch's region, frees every transient buffer
+
+		// Places a batch of buffers in one allocation, buffers whose steps don't overlap share memory. The steps are
+		// whatever the caller counts in, usually dispatches. A buffer's contents are undefined when its first step
+		// starts, barriers between the aliases are placed like between any other buffers.
+		std::vector<Buffer *> CreateAliasedBuffers(const std::vector<AliasedBufferDesc> &batch);
+
+		// Memory Budget
+		std::vector<HeapBudget> GetMemoryBudget(); // one entry per memory heap
+		void SetBudgetPolicy(BudgetPolicy policy, float threshold = 1.0f); // applies once an allocation would use more than threshold of the budget
+		VkDeviceSize TrimMemory(); // frees empty buffer pool blocks and an unused transient arena, returns the bytes freed
+
+		// Waits for the device to go idle and moves buffers together so the memory between them can be freed, returns
+		// the bytes given back. Moved buffers get a new devbuffer and address, shaders have to bind them again and
+		// command lists recorded with them have to be recorded again. If a moved buffer can't be rebound, the rest still
+		// are and Compact throws, the buffers that were in the failed allocations can only be deleted.
+		VkDeviceSize Compact();
+
+		// Asynchronous Buffer Operations
+		Transfer UploadDataAsync(Buffer *buffer, void *data); // data can be reused as soon as this returns
+		// data is copied out of the staging ring as the returned transfer retires, the caller has to Wait on it (or see
+		// Poll return true) before reading data. Deleting the buffer retires its transfers as well.
+		Transfer DownloadDataAsync(Buffer *buffer, void *data);
+		void Wait(Transfer transfer);
+		bool Poll(Transfer transfer);
+
+		// Compute Operations
+		Shader *CreateShader(const std::string fp, const std::vector<SpecConstant> &specialization = {}); // layout comes from the SPIR-V, buffers bind in binding order
+		Shader *CreateShader(const std::string fp, size_t BufferCount, uint32_t PushConstantSize = 0, const std::vector<SpecConstant> &specialization = {}); // checked against the SPIR-V
+		std::vector<Shader *> CreateShaders(const std::vector<ShaderDesc> &batch, unsigned threads = 0); // compiles the batch on worker threads, 0 uses one per core
+		std::future<Shader *> CreateShaderAsync(const std::string fp, size_t BufferCount, uint32_t PushConstantSize = 0, const std::vector<SpecConstant> &specialization = {});
+		void DeleteShader(Shader *shader);
+		void SetPipelineCacheFile(const std::string fp); // Pipelines are loaded from and saved to fp, which is checked against this device and driver
+		void SavePipelineCache();
+		void TrimShaderVariants(); // frees the cached pipelines and modules no shader uses anymore
+		void BindBuffers(Shader *shader, Buffer **buffers);
+		void UseBuffers(Shader *shader, Buffer **buffers, size_t count); // buffers the shader reaches through BufferAddress, synchronized like bound buffers
+		void RunShader(Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants = nullptr); // constants holds PushConstantSize bytes
+		Submission Submit(Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants = nullptr); // RunShader without waiting for it to finish
+		void Wait(Submission submission);
+		bool Poll(Submission submission);
+
+		// Dispatches enough workgroups of LocalSize to cover the given element counts, shaders have to skip the
+		// invocations past the end. Grids beyond maxComputeWorkGroupCount are split using base workgroup offsets.
+		Submission Dispatch1D(Shader *shader, uint32_t x, const void *constants = nullptr);
+		Submission Dispatch2D(Shader *shader, uint32_t x, uint32_t y, const void *constants = nullptr);
+		Submission Dispatch3D(Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants = nullptr);
+
+		// Command Lists
+		CommandList *CreateCommandList();
+		void DeleteCommandList(CommandList *list);
+		void RecordUpload(CommandList *list, Buffer *buffer, void *data);
+		void RecordDispatch(CommandList *list, Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants = nullptr); // uses the buffers bound to shader at record time
+		void RecordDownload(CommandList *list, Buffer *buffer, void *data); // data is filled in by Wait(list)
+		Submission Submit(CommandList *list);
+		void Wait(CommandList *list);
+
+		inline void setId(uint32_t id) { this->id = id; }
+		inline uint32_t getId() { return id; }
+		inline std::string getName() { return PhysicalDeviceProps.deviceName; }
+
+		inline VkDevice get() { return device; }
+		inline VkQueue getComputeQueue() { return ComputeQueue; }
+		inline VkQueue getTransferQueue() { return TransferQueue; }
+		inline VkPhysicalDeviceProperties getProps() { return PhysicalDeviceProps; }
+		inline VkPhysicalDevice getPhysicalDev() { return PhysicalDevice; }
+		inline VkCommandPool getShortCommandPool() { return Pool_ShortLived; } // Command pool for short lived command buffers
+		inline VkCommandPool getCommandPool() { return Pool; }
+		inline uint32_t *getQueueFamilyIndices() { return QueueFamilyIndices; } // [0] = Compute, [1] = Transfer
+		inline VmaAllocator getAllocator() { return allocator; }
+		inline VkDeviceSize getStagingSize() { return staging->getSize(); }
+		inline bool getBufferAddressSupport() { return SupportsBufferAddresses; }
+		inline bool getZeroCopySupport() { return ZeroCopy; } // every buffer is in host visible memory and mapped
+		inline bool getHostImportSupport() { return SupportsHostImport; }
+		inline VkDeviceSize getHostImportAlignment() { return HostImportAlignment; }
+
+		void operator=(const Device &devb);
+	protected:
+		VkPhysicalDevice PhysicalDevice;
+		VkPhysicalDeviceProperties PhysicalDeviceProps;
+		VkDevice device;
+		VkQueue ComputeQueue;
+		VkQueue TransferQueue;
+		VkCommandPool Pool_ShortLived;
+		VkCommandPool Pool;
+		uint32_t QueueFamilyIndices[2];
+		uint32_t id;
+		bool SupportsDispatchBase; // vkCmdDispatchBase, core since 1.1
+		bool SupportsUpdateTemplates; // vkUpdateDescriptorSetWithTemplate, core since 1.1
+		uint32_t MaxPushDescriptors; // 0 without VK_KHR_push_descriptor
+		bool SupportsBufferAddresses; // bufferDeviceAddress feature, every buffer gets an address
+		bool SupportsMemoryBudget; // VK_EXT_memory_budget, otherwise the budget is estimated from the heap sizes
+		bool SupportsHostImport; // VK_EXT_external_memory_host
+		VkDeviceSize HostImportAlignment; // minImportedHostPointerAlignment
+		uint32_t DeviceHeap; // heap device local buffers are allocated from
+		bool UnifiedMemory; // some memory of DeviceHeap is host visible, the memory MemoryUsage::Auto goes for
+		bool ZeroCopy; // some of it is host cached too, GPU only buffers are mapped as well
+		BudgetPolicy policy;
+		float threshold; // fraction of the budget the policy kicks in at
+
+		VmaAllocator allocator;
+		FencePool *fences; // shared between copies of this device
+		StagingRing *staging; // shared between copies of this device
+		PipelineCache *pipelinecache; // shared between copies of this device
+		VariantCache *variants; // shared between copies of this device
+		DescriptorAllocator *descriptors; // shared between copies of this device
+		DescriptorCache *descriptorcache; // shared between copies of this device
+		BufferPool *bufferpool; // shared between copies of this device
+		BufferArena *arena; // shared between copies of this device
+
+		void CreateVKBuffer(VkDeviceSize size, VkBufferUsageFlags usageflags, VmaMemoryUsage memusage, VkBuffer &buffer, VmaAllocation &allocation, VmaAllocationInfo *allocinfo); // mapped unless memusage is GPU only and there is no zero copy
+		VkDeviceSize BufferAlignment(); // offset alignment that lets a range of a buffer be bound
+		VkBufferUsageFlags BufferUsage(); // usage of every buffer made by CreateBuffer
+		Buffer *InsertBuffer(Buffer &buf); // fills in the tracking state and gives buf a slot
+		VkDeviceAddress DeviceAddress(VkBuffer buffer);
+		bool WithinBudget(VkDeviceSize size);
+		bool MakeRoom(VkDeviceSize size); // applies the budget policy, false when the allocation has to spill to host memory
+		void CopyVKBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize srcoffset, VkDeviceSize dstoffset, VkDeviceSize size, StagingSpan &span);
+		Shader *CompileShader(const std::string fp, size_t BufferCount, uint32_t PushConstantSize, const std::vector<SpecConstant> &specialization); // touches no shared pools, safe to call from several threads
+		void RecordShader(Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants);
+		VkAccessFlags ShaderAccess(Shader *shader, Buffer *buffer); // how a dispatch uses buffer through all of its bindings
+		void RecordGrid(VkCommandBuffer cmdbuf, uint32_t x, uint32_t y, uint32_t z); // vkCmdDispatch, split into pieces the device accepts
+		void BeginList(CommandList *list);
+		void *StageList(CommandList *list, VkDeviceSize size, VkBuffer &buffer, VkDeviceSize &offset);
+		void AccessList(CommandList *list, Buffer *buffer, VkPipelineStageFlags stage, VkAccessFlags access);
+		util::SlotMap<Buffer> *buffers; // shared between copies of this device
+		std::map<char *, util::SlotHandle> *imports; // imported buffers by host address, shared between copies of this device
+		Buffer *FindImport(void *data, VkDeviceSize size, VkDeviceSize &offset); // imported buffer holding the range, offset is where it starts
+	};
+
+	std::vector<vkcl::Device> QueryAllDevices();
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef VK_PIPELINE_H
+#define VK_PIPELINE_H
+
+#include <vkcl/volk.h>
+
+#include "util_exception.h"
+#include "util_logging.h"
+#include "vk_reflect.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <mutex>
+
+namespace vkcl {
+
+	// Header written in front of the driver's cache data, a file is only used by the device and driver that wrote it
+	struct PipelineCacheHeader {
+		char magic[8];
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+
+	class PipelineCache {
+	public:
+		PipelineCache() { }
+
+		void Load(VkDevice device, const VkPhysicalDeviceProperties &props);
+		void Delete(); // saves the cache first if it has a file
+
+		void SetFile(const std::string fp); // loads fp if it was written for this device, Save writes back to it
+		void Save();
+
+		inline VkPipelineCache get() { return cache; }
+		inline std::string getFile() { return file; }
+	protected:
+		VkDevice device;
+		VkPhysicalDeviceProperties props;
+		VkPipelineCache cache;
+		std::string file;
+
+		bool Matches(const PipelineCacheHeader &header); // written for this device and driver
+		bool Validate(const PipelineCacheHeader &header, const char *data);
+	};
+
+	// A 32 bit specialization constant, floats are passed by their bit pattern
+	struct SpecConstant {
+		uint32_t id;
+		uint32_t value;
+	};
+
+	// Everything a shader shares with other shaders built from the same SPIR-V, layout and constants
+	struct ShaderVariant {
+		VkShaderModule shadermod;
+		VkDescriptorSetLayout layout;
+		VkPipelineLayout pipelinelayout;
+		VkPipeline pipeline;
+		VkDescriptorUpdateTemplate update; // writes the buffer infos in binding order, VK_NULL_HANDLE without template support
+		bool push; // bindings are pushed into the command buffer instead of living in a descriptor set
+		uint64_t module; // key of shadermod
+		uint32_t refs;
+	};
+
+	class VariantCache {
+	public:
+		VariantCache() { }
+
+		// templates enables update templates, layouts with at most pushdescriptors bindings use push descriptors
+		void Load(VkDevice device, PipelineCache *pipelinecache, VkPipelineCreateFlags flags, bool templates, uint32_t pushdescriptors);
+		void Delete();
+
+		// Returns the variant for these constants, creating the module and pipeline on first use. Safe to call from several threads.
+		ShaderVariant *Acquire(const std::vector<uint32_t> &code, const std::vector<ShaderBinding> &bindings, uint32_t PushConstantSize, const std::vector<SpecConstant> &constants);
+		void Release(ShaderVariant *variant);
+		void Trim(); // destroys the variants and modules no shader uses anymore
+	protected:
+		typedef std::tuple<uint64_t, std::vector<uint32_t>, uint32_t, std::vector<uint32_t>> VariantKey; // code, layout, push constants, specialization
+
+		struct ModuleEntry {
+			VkShaderModule shadermod;
+			uint32_t refs; // variants using it
+		};
+
+		VkDevice device;
+		PipelineCache *pipelinecache;
+		VkPipelineCreateFlags flags; // added to every pipeline
+		bool templates;
+		uint32_t pushdescriptors; // 0 without VK_KHR_push_descriptor
+
+		std::mutex lock;
+		std::map<uint64_t, ModuleEntry> modules;
+		std::map<VariantKey, ShaderVariant *> variants;
+
+		VkShaderModule AcquireModule(uint64_t key, const std::vector<uint32_t> &code);
+		ShaderVariant *CreateVariant(VkShaderModule shadermod, const std::vector<ShaderBinding> &bindings, uint32_t PushConstantSize, const std::vector<SpecConstant> &constants);
+		void BuildVariant(ShaderVariant *variant, const std::vector<ShaderBinding> &bindings, uint32_t PushConstantSize, const std::vector<SpecConstant> &constants);
+		void DestroyVariant(ShaderVariant *variant);
+	};
+
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef VK_POOL_H
+#define VK_POOL_H
+
+#include <vkcl/volk.h>
+
+#include "util_exception.h"
+#include "util_slotmap.h"
+#include "vk_memory.h"
+#include "vk_sync.h"
+
+#include <vector>
+
+namespace vkcl {
+
+	const VkDeviceSize BufferPoolBlockSize = 4 * 1024 * 1024;
+	const VkDeviceSize BufferPoolMaxSize = 64 * 1024; // larger buffers get an allocation of their own
+	const VkDeviceSize ArenaDefaultSize = 16 * 1024 * 1024;
+	const uint32_t ArenaDefaultEpochs = 2;
+
+	// Device local memory. Mapped buffers go to host visible, preferably cached memory if it is device local as
+	// well, where it isn't they aren't mapped after all.
+	inline VmaAllocationCreateInfo LocalAllocation(bool mapped)
+	{
+		VmaAllocationCreateInfo info = {};
+		info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		if (mapped) {
+			info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+			info.preferredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		}
+
+		return info;
+	}
+
+	// A piece of one of the pool's blocks
+	struct PoolRange {
+		VkBuffer buffer;
+		VmaAllocation alloc; // of the whole block
+		VkDeviceSize offset;
+		uint32_t sizeclass;
+	};
+
+	// Carves small buffers out of a few large ones. Every range is rounded up to a power of two size class,
+	// freed ranges go on the free list of their class and are handed out again before a block grows.
+	class BufferPool {
+	public:
+		BufferPool() { }
+
+		void Load(VmaAllocator allocator, VkBufferUsageFlags usage, uint32_t *families, VkDeviceSize alignment, bool mapped);
+		void Delete();
+
+		PoolRange Allocate(VkDeviceSize size); // size has to be at most BufferPoolMaxSize
+		bool Available(VkDeviceSize size); // Allocate can hand out size bytes without allocating a new block
+		void Free(const PoolRange &range);
+		VkDeviceSize Trim(); // destroys the blocks no range is handed out from, returns the bytes freed
+		void Rebind(VkBuffer from, VkBuffer to); // a block's memory was moved and bound to a new buffer
+
+		inline VkDeviceSize ClassSize(uint32_t sizeclass) { return minsize << sizeclass; }
+	protected:
+		struct Block {
+			VkBuffer buffer;
+			VmaAllocation alloc;
+			VkDeviceSize used; // ranges are carved from the front
+			uint32_t live; // ranges handed out and not freed yet
+		};
+
+		VmaAllocator allocator;
+		VkBufferUsageFlags usage;
+		uint32_t families[2];
+		bool mapped; // blocks are persistently mapped where the memory allows
+		VkDeviceSize minsize; // smallest size class, a power of two that satisfies the offset alignment
+
+		std::vector<Block> blocks; // only the last one still grows
+		std::vector<std::vector<PoolRange>> freelists; // one per size class
+
+		void Grow(); // starts a new block, the rest of the old one goes to the free lists
+		Block &Owner(const PoolRange &range);
+		uint32_t SizeClass(VkDeviceSize size);
+	};
+
+	// Linear allocator for buffers that only live for one epoch. There is a region for every epoch that can be
+	// in flight, allocating bumps a pointer in the current one and a region is reset as a whole when its turn
+	// comes around again. The memory is only allocated once the arena is first used.
+	class BufferArena {
+	public:
+		BufferArena() : buffer(VK_NULL_HANDLE) { }
+
+		void Load(VmaAllocator allocator, VkBufferUsageFlags usage, uint32_t *families, VkDeviceSize alignment, bool mapped, VkDeviceSize size, uint32_t epochs);
+		void Delete();
+
+		bool Allocate(VkDeviceSize size, VkDeviceSize &offset); // false if the current region is full
+		void Track(util::SlotHandle handle); // handle belongs to the current epoch
+		std::vector<util::SlotHandle> Advance(); // moves to the next region, returns what was made in it the last time around
+		std::vector<util::SlotHandle> Tracked(); // of every region
+		VkDeviceSize Release(); // frees the memory until the next Allocate, the caller makes sure none of it is in use
+		inline void Rebind(VkBuffer from, VkBuffer to) { if (buffer == from) buffer = to; }
+
+		inline VkBuffer get() { return buffer; }
+		inline VmaAllocation getAllocation() { return alloc; }
+		inline VkDeviceSize getSize() { return size; }
+		inline uint32_t getEpochs() { return epochs; }
+	protected:
+		VmaAllocator allocator;
+		VkBufferUsageFlags usage;
+		uint32_t families[2];
+		VkDeviceSize alignment;
+		bool mapped;
+
+		VkBuffer buffer; // holds every region back to back
+		VmaAllocation alloc;
+		VkDeviceSize size; // of each region
+		uint32_t epochs;
+		uint32_t current;
+		VkDeviceSize used; // of the current region
+
+		std::vector<std::vector<util::SlotHandle>> tracked; // per region
+	};
+
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef VK_REFLECT_H
+#define VK_REFLECT_H
+
+#include <vkcl/volk.h>
+
+#include "util_exception.h"
+
+#include <vector>
+
+namespace vkcl {
+
+	struct ShaderBinding {
+		uint32_t set;
+		uint32_t binding;
+		VkDescriptorType type;
+		uint32_t count; // array size, 0 for runtime arrays
+		bool readonly; // the shader never writes through this binding
+	};
+
+	struct ShaderReflection {
+		std::vector<ShaderBinding> bindings; // sorted by set, then binding
+		uint32_t PushConstantSize;
+		uint32_t LocalSize[3];
+		uint32_t LocalSizeId[3]; // specialization constant overriding each LocalSize component, UINT32_MAX if there is none
+	};
+
+	// Reads the resource interface of the "main" compute entry point, throws if code is not a SPIR-V module
+	ShaderReflection ReflectShader(const uint32_t *code, size_t words);
+
+}
+
+#endif
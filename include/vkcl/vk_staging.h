@@ -0,0 +1,73 @@
+#ifndef VK_STAGING_H
+#define VK_STAGING_H
+
+#include <vkcl/volk.h>
+
+#include "util_exception.h"
+#include "vk_memory.h"
+#include "vk_sync.h"
+
+#include <deque>
+#include <vector>
+
+namespace vkcl {
+
+	const VkDeviceSize StagingDefaultSize = 16 * 1024 * 1024;
+	const VkDeviceSize StagingAlignment = 256;
+
+	// A region of the staging ring reserved for a single copy. It stays reserved
+	// until the fence it was submitted with has signalled and the span is retired.
+	struct StagingSpan {
+		uint64_t id;
+		VkDeviceSize offset; // offset into the ring buffer
+		VkDeviceSize size;
+		VkDeviceSize end; // ring position right after this span, becomes the tail on retire
+		void *mapped; // host pointer to the start of the span
+		void *readback; // if set, the span is copied here when it retires
+		VkFence fence;
+		Submission submission;
+		VkCommandBuffer commandbuffer; // the copy is recorded into this, it goes back to the ring on retire
+		bool submitted;
+	};
+
+	class StagingRing {
+	public:
+		StagingRing() : nextid(1) { }
+
+		void Load(VkDevice device, VmaAllocator allocator, FencePool *fences, VkCommandPool pool, uint32_t *families, VkDeviceSize size);
+		void Delete();
+
+		StagingSpan &Acquire(VkDeviceSize size); // blocks on the oldest spans until size bytes are free, 0 tracks a copy that bypasses the ring
+		void Retire(uint64_t id); // waits for every span up to and including id
+		bool Poll(uint64_t id); // retires the spans up to id if they have completed, without blocking
+		void Flush();
+
+		VkDeviceSize Chunk(VkDeviceSize size); // largest piece a transfer of size bytes should be split into
+
+		inline VkBuffer get() { return buffer; }
+		inline VkDeviceSize getSize() { return size; }
+	protected:
+		VkDevice device;
+		VmaAllocator allocator;
+		FencePool *fences;
+		VkCommandPool pool;
+
+		VkBuffer buffer;
+		VmaAllocation alloc;
+		VmaAllocationInfo allocinfo;
+		VkDeviceSize size;
+
+		// head and tail only ever grow, their position in the buffer is taken modulo size
+		VkDeviceSize head;
+		VkDeviceSize tail;
+		uint64_t nextid; // kept across reloads so older ids stay ordered before new ones
+
+		std::deque<StagingSpan> spans;
+		std::vector<VkCommandBuffer> commandbuffers; // of retired spans, recorded again by the next ones
+
+		void RetireFront();
+	};
+
+}
+
+#endif
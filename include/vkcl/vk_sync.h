@@ -0,0 +1,87 @@
+#ifndef VK_SYNC_H
+#define VK_SYNC_H
+
+#include <vkcl/volk.h>
+
+#include "util_exception.h"
+
+#include <deque>
+#include <vector>
+
+namespace vkcl {
+
+	// Buffers are used on the compute and the transfer queue, which only have to share them when they come from different families
+	inline void SetSharingMode(VkBufferCreateInfo &info, uint32_t *families)
+	{
+		bool shared = families[0] != families[1];
+		info.sharingMode = shared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+		info.queueFamilyIndexCount = shared ? 2 : 0;
+		info.pQueueFamilyIndices = shared ? families : nullptr;
+	}
+
+	// Handle to submitted work. The serial tells a recycled fence apart from the one the handle was given.
+	struct Submission {
+		uint32_t slot;
+		uint32_t serial;
+	};
+
+	// Submissions that may still be using an object. Work on a queue only completes in order where a barrier
+	// orders it, so the newest submission doesn't stand in for the ones before it.
+	typedef std::vector<Submission> SubmissionList;
+
+	// What happened to a buffer since its last write, used to only place barriers between dependent commands
+	struct AccessState {
+		VkPipelineStageFlags writestage; // stage and access of the last write
+		VkAccessFlags writeaccess;
+		VkPipelineStageFlags readstages; // stages that read the buffer since the last write
+		VkAccessFlags visible; // accesses the last write has already been made visible to
+	};
+
+	// Buffer barriers needed before the next command, recorded together in one vkCmdPipelineBarrier
+	struct BarrierBatch {
+		VkPipelineStageFlags srcstage;
+		VkPipelineStageFlags dststage;
+		std::vector<VkBufferMemoryBarrier> barriers;
+
+		BarrierBatch() : srcstage(0), dststage(0) { }
+
+		void Access(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, AccessState &state, VkPipelineStageFlags stage, VkAccessFlags access);
+		void Record(VkCommandBuffer commandbuffer);
+		inline bool empty() { return srcstage == 0; }
+	};
+
+	class FencePool {
+	public:
+		FencePool() { }
+
+		void Load(VkDevice device);
+		void Delete();
+
+		Submission Acquire(VkFence &fence); // hands out an unsignalled fence to submit with
+		void Wait(Submission submission);
+		bool Poll(Submission submission);
+		void Release(Submission submission); // returns a fence that was never submitted
+		void Track(SubmissionList &list, Submission submission); // adds submission after dropping the completed ones
+		void Wait(SubmissionList &list);
+		bool Poll(SubmissionList &list); // drops the completed submissions, true once none are left
+		void Flush();
+	protected:
+		struct Slot {
+			VkFence fence;
+			uint32_t serial;
+			bool busy;
+		};
+
+		VkDevice device;
+		std::vector<Slot> slots;
+		std::vector<uint32_t> idle;
+		std::deque<Submission> pending; // in acquisition order, may hold handles that were already released
+
+		bool Pending(Submission submission);
+		void Recycle(uint32_t slot);
+		void Reclaim();
+	};
+
+}
+
+#endif
@@ -1,9 +1,9 @@
-#ifndef VKCL_H
-#define VKCL_H
-
-#include "util_exception.h"
-#include "util_logging.h"
-#include "vk_device.h"
-#include "vk_instance.h"
-
-#endif
+#ifndef VKCL_H
+#define VKCL_H
+
+#include "util_exception.h"
+#include "util_logging.h"
+#include "vk_device.h"
+#include "vk_instance.h"
+
+#endif
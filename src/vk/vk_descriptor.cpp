@@ -0,0 +1,278 @@
+#include <vkcl/vk_descriptor.h>
+
+#include <algorithm>
+
+namespace vkcl {
+
+	void DescriptorAllocator::Load(VkDevice device, FencePool *fences)
+	{
+		this->device = device;
+		this->fences = fences;
+
+		current = CreatePool({});
+	}
+
+	void DescriptorAllocator::Delete()
+	{
+		for (auto &pool : pools)
+			vkDestroyDescriptorPool(device, pool.pool, nullptr);
+
+		pools.clear();
+		free.clear();
+		retired.clear();
+	}
+
+	uint32_t DescriptorAllocator::CreatePool(const std::vector<ShaderBinding> &bindings)
+	{
+		// room for DescriptorPoolSets sets of a few buffers each, or for one set that needs more than that
+		std::vector<VkDescriptorPoolSize> sizes = {
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, DescriptorPoolSets * 8 },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, DescriptorPoolSets * 2 }
+		};
+
+		for (auto &binding : bindings) {
+			auto it = std::find_if(sizes.begin(), sizes.end(), [&binding](const VkDescriptorPoolSize &p) { return p.type == binding.type; });
+			if (it == sizes.end())
+				sizes.push_back({ binding.type, binding.count });
+			else
+				it->descriptorCount = std::max(it->descriptorCount, binding.count * (uint32_t)bindings.size());
+		}
+
+		VkDescriptorPoolCreateInfo poolcreateinfo = {};
+		poolcreateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolcreateinfo.maxSets = DescriptorPoolSets;
+		poolcreateinfo.poolSizeCount = sizes.size();
+		poolcreateinfo.pPoolSizes = sizes.data();
+
+		Pool pool = {};
+		if (vkCreateDescriptorPool(device, &poolcreateinfo, NULL, &pool.pool) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Could not create descriptor pool");
+		}
+
+		pools.push_back(pool);
+		return pools.size() - 1;
+	}
+
+	void DescriptorAllocator::Retire()
+	{
+		while (!retired.empty() && fences->Poll(retired.front().submissions)) {
+			uint32_t index = retired.front().pool;
+			retired.pop_front();
+
+			// the current pool keeps filling up, every other one is reset as soon as it is empty
+			if (--pools[index].live == 0 && index != current) {
+				vkResetDescriptorPool(device, pools[index].pool, 0);
+				free.push_back(index);
+			}
+		}
+	}
+
+	DescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, const std::vector<ShaderBinding> &bindings)
+	{
+		Retire();
+
+		VkDescriptorSetAllocateInfo allocinfo = {};
+		allocinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocinfo.descriptorSetCount = 1;
+		allocinfo.pSetLayouts = &layout;
+
+		DescriptorSet set = {};
+		auto TryAllocate = [&](uint32_t index) {
+			allocinfo.descriptorPool = pools[index].pool;
+			if (vkAllocateDescriptorSets(device, &allocinfo, &set.handle) != VK_SUCCESS)
+				return false;
+
+			set.pool = index;
+			pools[index].live++;
+			return true;
+		};
+
+		if (TryAllocate(current))
+			return set;
+
+		// the current pool is full, move on to one that was reset, then to a new one sized for this set
+		uint32_t full = current;
+		if (!free.empty()) {
+			current = free.back();
+			free.pop_back();
+		} else {
+			current = CreatePool(bindings);
+		}
+
+		if (pools[full].live == 0) {
+			vkResetDescriptorPool(device, pools[full].pool, 0);
+			free.push_back(full);
+		}
+
+		if (TryAllocate(current))
+			return set;
+
+		if (pools[current].live == 0)
+			free.push_back(current);
+
+		current = CreatePool(bindings);
+		if (TryAllocate(current))
+			return set;
+
+		throw vkcl::util::Exception("Could not allocate descriptor set");
+	}
+
+	void DescriptorAllocator::Release(DescriptorSet set, const SubmissionList &submissions)
+	{
+		if (set.handle == VK_NULL_HANDLE)
+			return;
+
+		retired.push_back({ submissions, set.pool });
+		Retire();
+	}
+
+	bool DescriptorKey::operator==(const DescriptorKey &other) const
+	{
+		if (layout != other.layout || buffers.size() != other.buffers.size())
+			return false;
+
+		for (size_t i = 0; i < buffers.size(); i++) {
+			if (buffers[i].buffer != other.buffers[i].buffer || buffers[i].offset != other.buffers[i].offset || buffers[i].range != other.buffers[i].range)
+				return false;
+		}
+
+		return true;
+	}
+
+	size_t DescriptorKeyHash::operator()(const DescriptorKey &key) const
+	{
+		std::hash<uint64_t> hash;
+		size_t seed = hash((uint64_t)key.layout);
+
+		for (auto &info : key.buffers) {
+			seed ^= hash((uint64_t)info.buffer) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+			seed ^= hash(info.offset) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+			seed ^= hash(info.range) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		}
+
+		return seed;
+	}
+
+	void DescriptorCache::Load(VkDevice device, DescriptorAllocator *allocator, FencePool *fences, size_t capacity)
+	{
+		this->device = device;
+		this->allocator = allocator;
+		this->fences = fences;
+		this->capacity = capacity;
+	}
+
+	void DescriptorCache::Delete()
+	{
+		// the sets themselves go away with the allocator's pools
+		for (auto entry : lru)
+			delete entry;
+
+		entries.clear();
+		lru.clear();
+		users.clear();
+	}
+
+	DescriptorEntry *DescriptorCache::Acquire(VkDescriptorSetLayout layout, const std::vector<ShaderBinding> &bindings, const std::vector<VkDescriptorBufferInfo> &buffers, VkDescriptorUpdateTemplate update)
+	{
+		DescriptorKey key = { layout, buffers };
+
+		auto it = entries.find(key);
+		if (it != entries.end()) {
+			DescriptorEntry *entry = it->second;
+			lru.splice(lru.begin(), lru, entry->lru);
+			entry->refs++;
+			return entry;
+		}
+
+		DescriptorEntry *entry = new DescriptorEntry;
+		entry->key = key;
+		entry->set = allocator->Allocate(layout, bindings);
+		entry->refs = 1;
+		entry->stale = false;
+
+		if (update != VK_NULL_HANDLE) {
+			// the template already knows where each buffer info goes
+			vkUpdateDescriptorSetWithTemplate(device, entry->set.handle, update, entry->key.buffers.data());
+		} else {
+			std::vector<VkWriteDescriptorSet> writes(bindings.size());
+			for (size_t i = 0; i < bindings.size(); i++) {
+				writes[i] = {};
+				writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[i].dstSet = entry->set.handle;
+				writes[i].dstBinding = bindings[i].binding;
+				writes[i].dstArrayElement = 0;
+				writes[i].descriptorCount = 1;
+				writes[i].descriptorType = bindings[i].type;
+				writes[i].pBufferInfo = &entry->key.buffers[i];
+			}
+
+			vkUpdateDescriptorSets(device, writes.size(), writes.data(), 0, nullptr);
+		}
+
+		lru.push_front(entry);
+		entry->lru = lru.begin();
+		entries[key] = entry;
+		for (auto &info : entry->key.buffers)
+			users.insert({ { info.buffer, info.offset }, entry });
+
+		Evict();
+		return entry;
+	}
+
+	void DescriptorCache::Unlink(DescriptorEntry *entry)
+	{
+		entries.erase(entry->key);
+
+		for (auto &info : entry->key.buffers) {
+			auto range = users.equal_range({ info.buffer, info.offset });
+			for (auto it = range.first; it != range.second;)
+				it = it->second == entry ? users.erase(it) : std::next(it);
+		}
+	}
+
+	void DescriptorCache::Free(DescriptorEntry *entry)
+	{
+		allocator->Release(entry->set, entry->lastuse);
+		lru.erase(entry->lru);
+		delete entry;
+	}
+
+	void DescriptorCache::Release(DescriptorEntry *entry)
+	{
+		if (--entry->refs == 0 && entry->stale)
+			Free(entry);
+	}
+
+	void DescriptorCache::Evict()
+	{
+		// least recently acquired first, sets still held by someone stay
+		for (auto it = lru.end(); it != lru.begin() && entries.size() > capacity;) {
+			DescriptorEntry *entry = *--it;
+			if (entry->refs || entry->stale)
+				continue;
+
+			it++;
+			Unlink(entry);
+			Free(entry);
+		}
+	}
+
+	void DescriptorCache::Invalidate(VkBuffer buffer, VkDeviceSize offset)
+	{
+		// only the sets using the range are looked at, deleting a buffer doesn't scan the whole cache
+		auto range = users.equal_range({ buffer, offset });
+		std::vector<DescriptorEntry *> referencing;
+		for (auto it = range.first; it != range.second; it++) {
+			if (std::find(referencing.begin(), referencing.end(), it->second) == referencing.end()) // sets can bind the range more than once
+				referencing.push_back(it->second);
+		}
+
+		for (auto entry : referencing) {
+			Unlink(entry);
+			entry->stale = true;
+			if (entry->refs == 0)
+				Free(entry);
+		}
+	}
+
+}
@@ -1,615 +1,2022 @@
-#include <cmath>
-#include <cstring>
-#include <vkcl/vk_device.h>
-#include <cstring>
-
-namespace vkcl {
-
-	static vkcl::Instance vkinstance;
-
-	static uint32_t GetQueueFamily(uint32_t starting_point, VkPhysicalDevice PhysicalDevice, VkQueueFlagBits flags)
-	{
-		// Get Queue Family Indices
-		uint32_t QueueFamilyIndex = 0;
-		uint32_t QueueFamilyCount;
-		vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, nullptr);
-
-		std::vector<VkQueueFamilyProperties> QueueFamilyProps(QueueFamilyCount);
-		vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, QueueFamilyProps.data());
-
-		uint32_t i = starting_point;
-		for (auto prop : QueueFamilyProps) {
-			if (prop.queueCount > 0 && (prop.queueFlags & flags)) {
-				QueueFamilyIndex = i;
-				break;
-			}
-
-			i++;
-		}
-
-		if (QueueFamilyIndex == QueueFamilyCount) {
-			throw vkcl::util::Exception("Failed to get Queue Family Index");
-		}
-
-		return QueueFamilyIndex;
-	}
-
-	static uint32_t *GetSpv(uint32_t *len, const std::string fp)
-	{
-		FILE *f = fopen(fp.c_str(), "rb");
-		if ((!f) || (!len)) {
-			throw vkcl::util::Exception(std::string("Could not open SPIR-V file: ") + fp);
-			return nullptr;
-		}
-
-		// filesize
-		fseek(f, 0, SEEK_END);
-		uint32_t size = (unsigned)ftell(f);
-		fseek(f, 0, SEEK_SET);
-		uint32_t size_padded = (uint32_t)std::ceil(size / 4.0) * 4;
-		*len = size_padded;
-
-		// read file
-		char *data = (char *)malloc(size_padded);
-		if (data == NULL) {
-			throw vkcl::util::Exception(std::string("Could not allocate data for SPIR-V file: ") + fp);
-			return nullptr;
-		}
-
-		fread(data, size, 1, f);
-		fclose(f);
-
-		// pad data
-		for (auto i = size; i < size_padded; i++) {
-			data[i] = 0;
-		}
-
-		return (uint32_t *)data;		
-	}
-
-	std::vector<VkPhysicalDevice> QueryPhysicalDevices(VkInstance instance)
-	{
-		std::vector<VkPhysicalDevice> PhysicalDevices;
-	
-		uint32_t count;
-		if (vkEnumeratePhysicalDevices(instance, &count, nullptr) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Failed to query amount of physical devices");
-			return PhysicalDevices;
-		}
-
-		PhysicalDevices.resize(count);
-		if (vkEnumeratePhysicalDevices(instance, &count, PhysicalDevices.data()) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Failed to query physical devices");
-			return PhysicalDevices;
-		}
-		
-		return PhysicalDevices;
-	}
-
-	std::vector<std::string> QueryPhysicalDeviceNames(VkInstance instance)
-	{
-		std::vector<VkPhysicalDevice> PhysicalDevices = QueryPhysicalDevices(instance);
-		std::vector<std::string> PhysicalDeviceNames;
-
-		for (VkPhysicalDevice device : PhysicalDevices) {
-			VkPhysicalDeviceProperties props;
-			vkGetPhysicalDeviceProperties(device, &props);
-			PhysicalDeviceNames.emplace_back(std::string(props.deviceName));
-		}
-
-		return PhysicalDeviceNames;
-	}
-
-	Device::Device(VkInstance instance, VkPhysicalDevice PhysicalDevice)
-	{
-		Load(instance, PhysicalDevice);
-	}
-
-	Device::Device(const Device &dev)
-	{
-		Load(dev);
-	}
-
-	void Device::Load(const Device &dev)
-	{
-		this->PhysicalDevice = dev.PhysicalDevice;
-		this->PhysicalDeviceProps = dev.PhysicalDeviceProps;
-		this->device = dev.device;
-		this->ComputeQueue = dev.ComputeQueue;
-		this->TransferQueue = dev.TransferQueue;
-		this->Pool_ShortLived = dev.Pool_ShortLived;
-		this->Pool = dev.Pool;
-		this->QueueFamilyIndices[0] = dev.QueueFamilyIndices[0];
-		this->QueueFamilyIndices[1] = dev.QueueFamilyIndices[1];
-		this->id = dev.id;
-	}
-
-	void Device::Load(VkInstance instance, VkPhysicalDevice PhysicalDevice)
-	{
-		(void)instance;
-		this->PhysicalDevice = PhysicalDevice;
-
-		vkGetPhysicalDeviceProperties(PhysicalDevice, &PhysicalDeviceProps);
-
-		this->QueueFamilyIndices[0] = GetQueueFamily(0, PhysicalDevice, VK_QUEUE_COMPUTE_BIT);
-		this->QueueFamilyIndices[1] = GetQueueFamily(QueueFamilyIndices[0] + 1, PhysicalDevice, VK_QUEUE_TRANSFER_BIT);
-
-		// Create Logical Device
-		float CompQueuePriorities = 1.0f;
-		VkDeviceQueueCreateInfo CompQueueCreateInfo = {};
-		CompQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		CompQueueCreateInfo.pNext = nullptr;
-		CompQueueCreateInfo.flags = 0;
-		CompQueueCreateInfo.queueFamilyIndex = QueueFamilyIndices[0];
-		CompQueueCreateInfo.queueCount = 1;
-		CompQueueCreateInfo.pQueuePriorities = &CompQueuePriorities;
-
-		float TransQueuePriorities = 1.0f;
-		VkDeviceQueueCreateInfo TransQueueCreateInfo = {};
-		TransQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		TransQueueCreateInfo.pNext = nullptr;
-		TransQueueCreateInfo.flags = 0;
-		TransQueueCreateInfo.queueFamilyIndex = QueueFamilyIndices[1];
-		TransQueueCreateInfo.queueCount = 1;
-		TransQueueCreateInfo.pQueuePriorities = &TransQueuePriorities;
-
-		VkDeviceQueueCreateInfo QueueCreateInfos[2];
-		QueueCreateInfos[0] = CompQueueCreateInfo;
-		QueueCreateInfos[1] = TransQueueCreateInfo;
-
-		VkPhysicalDeviceFeatures PhysDevFeatures = {}; // We only need compute, and we still need this struct.
-		VkDeviceCreateInfo DevCreateInfo = {};
-		DevCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-		DevCreateInfo.pNext = nullptr;
-		DevCreateInfo.flags = 0;
-		DevCreateInfo.queueCreateInfoCount = 2;
-		DevCreateInfo.pQueueCreateInfos = QueueCreateInfos;
-		DevCreateInfo.enabledLayerCount = 0;
-		DevCreateInfo.ppEnabledLayerNames = nullptr;
-		DevCreateInfo.enabledExtensionCount = 0;
-		DevCreateInfo.ppEnabledExtensionNames = nullptr;
-		DevCreateInfo.pEnabledFeatures = &PhysDevFeatures;
-	
-		if (vkCreateDevice(PhysicalDevice, &DevCreateInfo, nullptr, &device) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Failed to create device");
-		}
-
-		vkGetDeviceQueue(device, QueueFamilyIndices[0], 0, &ComputeQueue);
-		vkGetDeviceQueue(device, QueueFamilyIndices[1], 0, &TransferQueue);
-
-		VkCommandPoolCreateInfo Pool_ShortLivedInfo = {};
-		Pool_ShortLivedInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		Pool_ShortLivedInfo.queueFamilyIndex = QueueFamilyIndices[1];
-		Pool_ShortLivedInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-
-		VkCommandPoolCreateInfo PoolInfo = {};
-		PoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		PoolInfo.queueFamilyIndex = QueueFamilyIndices[0];
-		PoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-
-		if (vkCreateCommandPool(device, &Pool_ShortLivedInfo, nullptr, &Pool_ShortLived) != VK_SUCCESS) {
-			Pool_ShortLived = VK_NULL_HANDLE;
-			throw vkcl::util::Exception("Failed to create Staging Command Pool");
-		}
-
-		if (vkCreateCommandPool(device, &PoolInfo, nullptr, &Pool) != VK_SUCCESS) {
-			Pool = VK_NULL_HANDLE;
-			throw vkcl::util::Exception("Failed to create Command Pool");
-		}
-
-		// Create the buffer allocator
-		VmaAllocatorCreateInfo allocatorInfo = {};
-		allocatorInfo.physicalDevice = PhysicalDevice;
-		allocatorInfo.device = device;
-		allocatorInfo.instance = instance;
-		allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_2;
-
-		if (vmaCreateAllocator(&allocatorInfo, &allocator) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Failed to create allocator!");
-		}
-	}
-
-	uint32_t Device::MemoryType(uint32_t Type, VkMemoryPropertyFlags Props)
-	{
-		VkPhysicalDeviceMemoryProperties MemProps;
-		
-		vkGetPhysicalDeviceMemoryProperties(this->PhysicalDevice, &MemProps);
-
-		for (uint32_t i = 0; i < MemProps.memoryTypeCount; ++i) {
-			if ((Type & (1 << i)) && ((MemProps.memoryTypes[i].propertyFlags & Props) == Props))
-				return i;
-		}
-
-		return -1;
-	}
-
-	void Device::Delete()
-	{
-		for (auto &i : buffers)
-			DeleteBuffer(i);
-
-		vmaDestroyAllocator(allocator);
-
-		if (Pool_ShortLived != VK_NULL_HANDLE)
-			vkDestroyCommandPool(device, Pool_ShortLived, nullptr);
-		if (Pool != VK_NULL_HANDLE)
-			vkDestroyCommandPool(device, Pool, nullptr);
-		if (device != VK_NULL_HANDLE)
-			vkDestroyDevice(device, nullptr);
-	}
-
-	void Device::operator=(const Device &devb)
-	{
-		this->PhysicalDevice = devb.PhysicalDevice;
-		this->PhysicalDeviceProps = devb.PhysicalDeviceProps;
-		this->device = devb.device;
-		this->ComputeQueue = devb.ComputeQueue;
-		this->TransferQueue = devb.TransferQueue;
-		this->Pool_ShortLived = devb.Pool_ShortLived;
-		this->Pool = devb.Pool;
-		this->QueueFamilyIndices[0] = devb.QueueFamilyIndices[0];
-		this->QueueFamilyIndices[1] = devb.QueueFamilyIndices[1];
-		this->allocator = devb.allocator;
-	}
-
-	std::vector<Device> QueryAllDevices()
-	{
-		std::vector<vkcl::Device> devices;
-
-		try {
-			if (!vkinstance.getLoaded())
-				vkinstance.Load();
-			
-			std::vector<VkPhysicalDevice> physdevs = QueryPhysicalDevices(vkinstance.get());
-			devices.resize(physdevs.size());
-
-			for (uint32_t i = 0; i < physdevs.size(); i++) {
-				vkcl::Device device(vkinstance.get(), physdevs[i]);
-				device.setId(i);
-				devices[i] = device;
-			}
-
-		} catch (vkcl::util::Exception &e) {
-			vkcl::util::libLogger.Error(e.getMsg());
-		}
-
-		return devices;
-	}
-	
-
-	// Buffer Operations
-
-	void Device::CreateVKBuffer(VkDeviceSize size, VkBufferUsageFlags usageflags, VkMemoryPropertyFlags memflags, VkBuffer &buffer, VmaAllocation &allocation, VmaAllocationInfo *allocinfo)
-	{
-		uint32_t *families = getQueueFamilyIndices();
-
-		VkBufferCreateInfo BufferCreateInfo = {};
-		BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		BufferCreateInfo.size = size;
-		BufferCreateInfo.usage = usageflags;
-		BufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-		BufferCreateInfo.queueFamilyIndexCount = 2;
-		BufferCreateInfo.pQueueFamilyIndices = families;
-
-		VmaAllocationCreateInfo VbAllocInfo = {};
-
-		if (memflags == (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
-			VbAllocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-			VbAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
-		} else if (memflags && VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-			VbAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-		}
-
-		vmaCreateBuffer(this->allocator, &BufferCreateInfo, &VbAllocInfo, &buffer, &allocation, allocinfo);
-	}
-
-	void Device::CopyVKBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size)
-	{
-		VkCommandBufferAllocateInfo cmdbufinfo = {};
-		cmdbufinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		cmdbufinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		cmdbufinfo.commandPool = getShortCommandPool();
-		cmdbufinfo.commandBufferCount = 1;
-
-		VkCommandBuffer cmdbuf;
-		if (vkAllocateCommandBuffers(device, &cmdbufinfo, &cmdbuf) != VK_SUCCESS) {
-			throw vkcl::util::Exception(std::string("Failed to allocate command buffer for transfer operation")); 
-		}
-
-		VkCommandBufferBeginInfo begininfo = {};
-		begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begininfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		vkBeginCommandBuffer(cmdbuf, &begininfo);
-
-		// VK COMMANDS START
-
-		VkBufferCopy copyregion = {};
-		copyregion.srcOffset = 0;
-		copyregion.dstOffset = 0;
-		copyregion.size = size;
-		vkCmdCopyBuffer(cmdbuf, src, dst, 1, &copyregion);
-
-		// VK COMMANDS END
-
-		vkEndCommandBuffer(cmdbuf);
-
-		VkSubmitInfo submitinfo = {};
-		submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitinfo.commandBufferCount = 1;
-		submitinfo.pCommandBuffers = &cmdbuf;
-
-		VkFence fence;
-		VkFenceCreateInfo fenceinfo = {};
-		fenceinfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceinfo.flags = 0;
-		vkCreateFence(device, &fenceinfo, nullptr, &fence);
-
-		vkQueueSubmit(getTransferQueue(), 1, &submitinfo, fence);
-		vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
-
-		vkDestroyFence(device, fence, nullptr);
-		vkFreeCommandBuffers(device, getShortCommandPool(), 1, &cmdbuf);
-	}
-
-
-	Buffer *Device::CreateBuffer(VkDeviceSize size)
-	{
-		Buffer *buf = new Buffer;
-		if (!buf)
-			return nullptr;
-
-		CreateVKBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buf->devbuffer, buf->devalloc, &buf->devinfo);
-
-		buffers.push_back(buf);
-
-		return buf;
-	}
-
-	void Device::DeleteBuffer(Buffer *buffer)
-	{
-		for (size_t i = 0; i < buffers.size(); i++) {
-			if (buffers[i] == buffer) {
-				buffers.erase(buffers.begin() + i);
-				break;
-			}
-		}
-
-		vmaDestroyBuffer(allocator, buffer->devbuffer, buffer->devalloc);
-		delete buffer;
-	}
-
-	void Device::UploadData(Buffer *buffer, void *data)
-	{
-		VkBuffer hostbuf;
-		VmaAllocation hostalloc;
-		VmaAllocationInfo allocinfo;
-
-		CreateVKBuffer(buffer->devinfo.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, hostbuf, hostalloc, &allocinfo);
-		std::memcpy(allocinfo.pMappedData, data, buffer->devinfo.size);
-		CopyVKBuffer(hostbuf, buffer->devbuffer, buffer->devinfo.size);
-
-		vmaDestroyBuffer(allocator, hostbuf, hostalloc);
-	}
-
-	void *Device::DownloadData(Buffer *buffer)
-	{
-		void *data = malloc(buffer->devinfo.size);
-
-		VkBuffer hostbuf;
-		VmaAllocation hostalloc;
-		VmaAllocationInfo allocinfo;
-
-		CreateVKBuffer(buffer->devinfo.size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, hostbuf, hostalloc, &allocinfo);
-		CopyVKBuffer(buffer->devbuffer, hostbuf, buffer->devinfo.size);
-		std::memcpy(data, allocinfo.pMappedData, allocinfo.size);
-		vmaDestroyBuffer(allocator, hostbuf, hostalloc);
-
-		return data;
-	}
-
-	void Device::ReleaseData(void *data)
-	{
-		free(data);
-	}
-
-	
-	// Compute Operations
-
-	Shader *Device::CreateShader(const std::string fp, size_t BufferCount)
-	{
-		Shader *shader = new Shader;
-		shader->BufferCount = BufferCount;
-
-		VkDescriptorSetLayoutBinding *bindings = (VkDescriptorSetLayoutBinding *)malloc(sizeof(VkDescriptorSetLayoutBinding) * BufferCount);
-		if (!bindings) {
-			throw vkcl::util::Exception("Failed to allocate memory for Descriptor Set Layout Bindings");
-		}
-
-		for (size_t i = 0; i < BufferCount; i++) { // boiler plate code is for retards
-			bindings[i] = {};
-			bindings[i].binding = i; // 0 : input, 1 : output
-			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-			bindings[i].descriptorCount = 1;
-			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-			bindings[i].pImmutableSamplers = nullptr;
-		}
-
-		// struct for holding layout bindings to create layout object
-		VkDescriptorSetLayoutCreateInfo layoutcreateinfo = {};
-		layoutcreateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		layoutcreateinfo.bindingCount = BufferCount;
-		layoutcreateinfo.pBindings = bindings;
-
-		if (vkCreateDescriptorSetLayout(device, &layoutcreateinfo, NULL, &shader->layout) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Could not create descriptor set layout");
-		}
-
-		free(bindings);
-		
-		VkDescriptorPoolSize poolsize = {};
-		poolsize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		poolsize.descriptorCount = BufferCount;
-
-		VkDescriptorPoolCreateInfo poolcreateinfo = {};
-		poolcreateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolcreateinfo.maxSets = 1;
-		poolcreateinfo.poolSizeCount = 1;
-		poolcreateinfo.pPoolSizes = &poolsize;
-
-		if (vkCreateDescriptorPool(device, &poolcreateinfo, NULL, &shader->pool) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Could not create descriptor pool");
-		}
-		
-		// allocate descriptor set
-		VkDescriptorSetAllocateInfo allocinfo = {};
-		allocinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocinfo.descriptorPool = shader->pool;
-		allocinfo.descriptorSetCount = 1;
-		allocinfo.pSetLayouts = &shader->layout;
-
-		if (vkAllocateDescriptorSets(device, &allocinfo, &shader->set) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Could not allocate descriptor set ");
-		}
-
-		// Create shader module
-		uint32_t len = 0;
-		uint32_t *code = nullptr;
-		
-		try { 
-			code = GetSpv(&len, fp);
-		} catch (vkcl::util::Exception& e) {
-			throw e;
-		}
-
-		if (!code)
-			throw vkcl::util::Exception("Could not load shader code");
-
-		VkShaderModuleCreateInfo modcreateinfo = {};
-		modcreateinfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		modcreateinfo.pCode = code;
-		modcreateinfo.codeSize = len;
-
-		if (vkCreateShaderModule(device, &modcreateinfo, NULL, &shader->shadermod) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Could not allocate shader module");
-		}
-
-		free(code);
-
-		// Create pipeline
-		VkPipelineLayoutCreateInfo pipelinelayoutcreateinfo = {};
-		pipelinelayoutcreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelinelayoutcreateinfo.pNext = nullptr;
-		pipelinelayoutcreateinfo.setLayoutCount = 1;
-		pipelinelayoutcreateinfo.pSetLayouts = &shader->layout;
-		
-		if (vkCreatePipelineLayout(device, &pipelinelayoutcreateinfo, nullptr, &shader->pipelinelayout) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Could not create Compute Pipeline Layout");
-		}
-		
-		VkPipelineShaderStageCreateInfo shaderstagecreateinfo = {}; 
-		shaderstagecreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		shaderstagecreateinfo.pNext = nullptr;
-		shaderstagecreateinfo.flags = VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT_EXT;
-		shaderstagecreateinfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-		shaderstagecreateinfo.module = shader->shadermod;
-		shaderstagecreateinfo.pName = "main";
-		shaderstagecreateinfo.pSpecializationInfo = nullptr;
-
-		VkComputePipelineCreateInfo pipelinecreateinfo = {};
-		pipelinecreateinfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-		pipelinecreateinfo.pNext = nullptr;
-		pipelinecreateinfo.stage = shaderstagecreateinfo;
-		pipelinecreateinfo.layout = shader->pipelinelayout;
-
-		if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelinecreateinfo, nullptr, &shader->pipeline) != VK_SUCCESS) {
-			throw vkcl::util::Exception("Could not create Compute Pipeline");
-		}
-
-		// Allocate command buffer from device
-		VkCommandBufferAllocateInfo commandbufferinfo = {};
-		commandbufferinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		commandbufferinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		commandbufferinfo.commandPool = getCommandPool();
-		commandbufferinfo.commandBufferCount = 1;
-
-		if (vkAllocateCommandBuffers(device, &commandbufferinfo, &shader->commandbuffer) != VK_SUCCESS) {
-			throw vkcl::util::Exception(std::string("Failed to allocate command buffer for compute operation")); 
-		}
-
-		VkFenceCreateInfo fenceinfo = {};
-		fenceinfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceinfo.flags = 0;
-		vkCreateFence(device, &fenceinfo, nullptr, &shader->fence);
-
-		return shader;
-	}
-
-	void Device::DeleteShader(Shader *shader)
-	{
-		vkDestroyFence(device, shader->fence, nullptr);
-		vkFreeCommandBuffers(device, getCommandPool(), 1, &shader->commandbuffer);
-		vkDestroyPipeline(device, shader->pipeline, nullptr);
-		vkDestroyPipelineLayout(device, shader->pipelinelayout, nullptr);
-		vkDestroyShaderModule(device, shader->shadermod, nullptr);
-		vkDestroyDescriptorSetLayout(device, shader->layout, nullptr);
-		vkDestroyDescriptorPool(device, shader->pool, nullptr);		
-
-		delete shader;
-	}
-
-	void Device::BindBuffers(Shader *shader, Buffer **buffers)
-	{
-		VkDescriptorBufferInfo *bufferinfo = new VkDescriptorBufferInfo[shader->BufferCount];
-		VkWriteDescriptorSet *write = new VkWriteDescriptorSet[shader->BufferCount];
-
-		for (size_t i = 0; i < shader->BufferCount; i++) {
-			bufferinfo[i].offset = 0;
-			bufferinfo[i].range = VK_WHOLE_SIZE;
-			bufferinfo[i].buffer = buffers[i]->devbuffer;
-
-			write[i] = {};
-			write[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			write[i].pNext = nullptr;
-			write[i].dstSet = shader->set;
-			write[i].dstBinding = i;
-			write[i].dstArrayElement = 0;
-			write[i].descriptorCount = 1;
-			write[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-			write[i].pBufferInfo = &bufferinfo[i];			
-		}
-
-		vkUpdateDescriptorSets(device, shader->BufferCount, write, 0, NULL);
-
-		delete[] bufferinfo;
-		delete[] write;
-	}
-
-	void Device::RunShader(Shader *shader, uint32_t x, uint32_t y, uint32_t z)
-	{
-		VkCommandBufferBeginInfo begininfo = {};
-		begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begininfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		vkBeginCommandBuffer(shader->commandbuffer, &begininfo);
-
-		// VK COMMANDS START
-
-		vkCmdBindPipeline(shader->commandbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, shader->pipeline);
-		vkCmdBindDescriptorSets(shader->commandbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, shader->pipelinelayout, 0, 1, &shader->set, 0, nullptr);
-		vkCmdDispatch(shader->commandbuffer, x, y, z);
-
-		// VK COMMANDS END
-
-		vkEndCommandBuffer(shader->commandbuffer);
-
-		VkSubmitInfo submitinfo = {};
-		submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitinfo.commandBufferCount = 1;
-		submitinfo.pCommandBuffers = &shader->commandbuffer;
-
-		vkQueueSubmit(getComputeQueue(), 1, &submitinfo, shader->fence);
-		vkWaitForFences(device, 1, &shader->fence, VK_TRUE, UINT64_MAX);
-		vkResetFences(device, 1, &shader->fence);		
-	}
-
-
-}
+#include <cmath>
+#include <cstring>
+#include <vkcl/vk_device.h>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <unordered_map>
+
+namespace vkcl {
+
+	static vkcl::Instance vkinstance;
+
+	// First family with queues supporting flags other than exclude, UINT32_MAX if there is none
+	static uint32_t GetQueueFamily(const std::vector<VkQueueFamilyProperties> &QueueFamilyProps, VkQueueFlags flags, uint32_t exclude)
+	{
+		for (uint32_t i = 0; i < QueueFamilyProps.size(); i++) {
+			if (i != exclude && QueueFamilyProps[i].queueCount > 0 && (QueueFamilyProps[i].queueFlags & flags))
+				return i;
+		}
+
+		return UINT32_MAX;
+	}
+
+	// Aliased buffers share their hazard tracking with the rest of their group
+	static inline Buffer *Tracked(Buffer *buffer)
+	{
+		return buffer->group ? &buffer->group->memory : buffer;
+	}
+
+	static bool HasDeviceExtension(VkPhysicalDevice PhysicalDevice, const char *name)
+	{
+		uint32_t ExtensionCount;
+		vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &ExtensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> ExtensionProps(ExtensionCount);
+		vkEnumerateDeviceExtensionProperties(PhysicalDevice, nullptr, &ExtensionCount, ExtensionProps.data());
+
+		for (auto &prop : ExtensionProps) {
+			if (std::strcmp(prop.extensionName, name) == 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	static uint32_t *GetSpv(uint32_t *len, const std::string fp)
+	{
+		FILE *f = fopen(fp.c_str(), "rb");
+		if ((!f) || (!len)) {
+			throw vkcl::util::Exception(std::string("Could not open SPIR-V file: ") + fp);
+			return nullptr;
+		}
+
+		// filesize
+		fseek(f, 0, SEEK_END);
+		uint32_t size = (unsigned)ftell(f);
+		fseek(f, 0, SEEK_SET);
+		uint32_t size_padded = (uint32_t)std::ceil(size / 4.0) * 4;
+		*len = size_padded;
+
+		// read file
+		char *data = (char *)malloc(size_padded);
+		if (data == NULL) {
+			throw vkcl::util::Exception(std::string("Could not allocate data for SPIR-V file: ") + fp);
+			return nullptr;
+		}
+
+		fread(data, size, 1, f);
+		fclose(f);
+
+		// pad data
+		for (auto i = size; i < size_padded; i++) {
+			data[i] = 0;
+		}
+
+		return (uint32_t *)data;		
+	}
+
+	std::vector<VkPhysicalDevice> QueryPhysicalDevices(VkInstance instance)
+	{
+		std::vector<VkPhysicalDevice> PhysicalDevices;
+	
+		uint32_t count;
+		if (vkEnumeratePhysicalDevices(instance, &count, nullptr) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to query amount of physical devices");
+			return PhysicalDevices;
+		}
+
+		PhysicalDevices.resize(count);
+		if (vkEnumeratePhysicalDevices(instance, &count, PhysicalDevices.data()) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to query physical devices");
+			return PhysicalDevices;
+		}
+		
+		return PhysicalDevices;
+	}
+
+	std::vector<std::string> QueryPhysicalDeviceNames(VkInstance instance)
+	{
+		std::vector<VkPhysicalDevice> PhysicalDevices = QueryPhysicalDevices(instance);
+		std::vector<std::string> PhysicalDeviceNames;
+
+		for (VkPhysicalDevice device : PhysicalDevices) {
+			VkPhysicalDeviceProperties props;
+			vkGetPhysicalDeviceProperties(device, &props);
+			PhysicalDeviceNames.emplace_back(std::string(props.deviceName));
+		}
+
+		return PhysicalDeviceNames;
+	}
+
+	Device::Device(VkInstance instance, VkPhysicalDevice PhysicalDevice)
+	{
+		Load(instance, PhysicalDevice);
+	}
+
+	Device::Device(const Device &dev)
+	{
+		Load(dev);
+	}
+
+	void Device::Load(const Device &dev)
+	{
+		this->PhysicalDevice = dev.PhysicalDevice;
+		this->PhysicalDeviceProps = dev.PhysicalDeviceProps;
+		this->device = dev.device;
+		this->ComputeQueue = dev.ComputeQueue;
+		this->TransferQueue = dev.TransferQueue;
+		this->Pool_ShortLived = dev.Pool_ShortLived;
+		this->Pool = dev.Pool;
+		this->QueueFamilyIndices[0] = dev.QueueFamilyIndices[0];
+		this->QueueFamilyIndices[1] = dev.QueueFamilyIndices[1];
+		this->id = dev.id;
+		this->SupportsDispatchBase = dev.SupportsDispatchBase;
+		this->SupportsUpdateTemplates = dev.SupportsUpdateTemplates;
+		this->MaxPushDescriptors = dev.MaxPushDescriptors;
+		this->SupportsBufferAddresses = dev.SupportsBufferAddresses;
+		this->SupportsMemoryBudget = dev.SupportsMemoryBudget;
+		this->SupportsHostImport = dev.SupportsHostImport;
+		this->HostImportAlignment = dev.HostImportAlignment;
+		this->DeviceHeap = dev.DeviceHeap;
+		this->UnifiedMemory = dev.UnifiedMemory;
+		this->ZeroCopy = dev.ZeroCopy;
+		this->policy = dev.policy;
+		this->threshold = dev.threshold;
+		this->allocator = dev.allocator;
+		this->fences = dev.fences;
+		this->staging = dev.staging;
+		this->pipelinecache = dev.pipelinecache;
+		this->variants = dev.variants;
+		this->descriptors = dev.descriptors;
+		this->bufferpool = dev.bufferpool;
+		this->buffers = dev.buffers;
+		this->imports = dev.imports;
+		this->arena = dev.arena;
+		this->descriptorcache = dev.descriptorcache;
+	}
+
+	void Device::Load(VkInstance instance, VkPhysicalDevice PhysicalDevice)
+	{
+		(void)instance;
+		this->PhysicalDevice = PhysicalDevice;
+
+		vkGetPhysicalDeviceProperties(PhysicalDevice, &PhysicalDeviceProps);
+
+		uint32_t QueueFamilyCount;
+		vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> QueueFamilyProps(QueueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount, QueueFamilyProps.data());
+
+		this->QueueFamilyIndices[0] = GetQueueFamily(QueueFamilyProps, VK_QUEUE_COMPUTE_BIT, UINT32_MAX);
+		if (QueueFamilyIndices[0] == UINT32_MAX) {
+			throw vkcl::util::Exception("Failed to get Queue Family Index");
+		}
+
+		// Transfers get a family of their own where there is one. Devices with a single family, like lavapipe and
+		// SwiftShader, take a second queue from it or share the only one.
+		this->QueueFamilyIndices[1] = GetQueueFamily(QueueFamilyProps, VK_QUEUE_TRANSFER_BIT, QueueFamilyIndices[0]);
+		if (QueueFamilyIndices[1] == UINT32_MAX)
+			this->QueueFamilyIndices[1] = QueueFamilyIndices[0];
+
+		bool SharedQueueFamily = QueueFamilyIndices[0] == QueueFamilyIndices[1];
+		uint32_t TransferQueueIndex = (SharedQueueFamily && QueueFamilyProps[QueueFamilyIndices[0]].queueCount > 1) ? 1 : 0;
+
+		// Create Logical Device
+		float CompQueuePriorities[2] = { 1.0f, 1.0f };
+		VkDeviceQueueCreateInfo CompQueueCreateInfo = {};
+		CompQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		CompQueueCreateInfo.pNext = nullptr;
+		CompQueueCreateInfo.flags = 0;
+		CompQueueCreateInfo.queueFamilyIndex = QueueFamilyIndices[0];
+		CompQueueCreateInfo.queueCount = SharedQueueFamily ? TransferQueueIndex + 1 : 1;
+		CompQueueCreateInfo.pQueuePriorities = CompQueuePriorities;
+
+		float TransQueuePriorities = 1.0f;
+		VkDeviceQueueCreateInfo TransQueueCreateInfo = {};
+		TransQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		TransQueueCreateInfo.pNext = nullptr;
+		TransQueueCreateInfo.flags = 0;
+		TransQueueCreateInfo.queueFamilyIndex = QueueFamilyIndices[1];
+		TransQueueCreateInfo.queueCount = 1;
+		TransQueueCreateInfo.pQueuePriorities = &TransQueuePriorities;
+
+		VkDeviceQueueCreateInfo QueueCreateInfos[2];
+		QueueCreateInfos[0] = CompQueueCreateInfo;
+		QueueCreateInfos[1] = TransQueueCreateInfo;
+
+		// Optional extensions, none of them are needed to run shaders
+		std::vector<const char *> Extensions;
+		bool PushDescriptors = HasDeviceExtension(PhysicalDevice, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+		if (PushDescriptors)
+			Extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+
+		// Buffer device addresses let shaders reach buffers through pointers passed in push constants,
+		// they are core since 1.2 and an extension before that
+		bool AddressExtension = PhysicalDeviceProps.apiVersion < VK_API_VERSION_1_2 && HasDeviceExtension(PhysicalDevice, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+		VkPhysicalDeviceBufferDeviceAddressFeatures AddressFeatures = {};
+		AddressFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+		if ((PhysicalDeviceProps.apiVersion >= VK_API_VERSION_1_2 || AddressExtension) && vkGetPhysicalDeviceFeatures2 != nullptr) {
+			VkPhysicalDeviceFeatures2 Features2 = {};
+			Features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			Features2.pNext = &AddressFeatures;
+			vkGetPhysicalDeviceFeatures2(PhysicalDevice, &Features2);
+		}
+
+		bool BufferAddresses = AddressFeatures.bufferDeviceAddress == VK_TRUE;
+		AddressFeatures.pNext = nullptr;
+		AddressFeatures.bufferDeviceAddressCaptureReplay = VK_FALSE;
+		AddressFeatures.bufferDeviceAddressMultiDevice = VK_FALSE;
+		if (BufferAddresses && AddressExtension)
+			Extensions.push_back(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+
+		// Lets the budget account for other processes and libraries using the same heaps
+		SupportsMemoryBudget = HasDeviceExtension(PhysicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) && vkGetPhysicalDeviceMemoryProperties2 != nullptr;
+		if (SupportsMemoryBudget)
+			Extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+		// Lets the transfer queue copy straight from and to memory the caller allocated
+		SupportsHostImport = PhysicalDeviceProps.apiVersion >= VK_API_VERSION_1_1 && HasDeviceExtension(PhysicalDevice, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) &&
+			vkGetPhysicalDeviceProperties2 != nullptr;
+		if (SupportsHostImport)
+			Extensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+
+		VkPhysicalDeviceFeatures PhysDevFeatures = {}; // We only need compute, and we still need this struct.
+		VkDeviceCreateInfo DevCreateInfo = {};
+		DevCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		DevCreateInfo.pNext = BufferAddresses ? &AddressFeatures : nullptr;
+		DevCreateInfo.flags = 0;
+		DevCreateInfo.queueCreateInfoCount = SharedQueueFamily ? 1 : 2;
+		DevCreateInfo.pQueueCreateInfos = QueueCreateInfos;
+		DevCreateInfo.enabledLayerCount = 0;
+		DevCreateInfo.ppEnabledLayerNames = nullptr;
+		DevCreateInfo.enabledExtensionCount = Extensions.size();
+		DevCreateInfo.ppEnabledExtensionNames = Extensions.data();
+		DevCreateInfo.pEnabledFeatures = &PhysDevFeatures;
+	
+		if (vkCreateDevice(PhysicalDevice, &DevCreateInfo, nullptr, &device) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to create device");
+		}
+
+		vkGetDeviceQueue(device, QueueFamilyIndices[0], 0, &ComputeQueue);
+		vkGetDeviceQueue(device, QueueFamilyIndices[1], TransferQueueIndex, &TransferQueue);
+
+		VkCommandPoolCreateInfo Pool_ShortLivedInfo = {};
+		Pool_ShortLivedInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		Pool_ShortLivedInfo.queueFamilyIndex = QueueFamilyIndices[1];
+		Pool_ShortLivedInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // staging spans re-record theirs
+
+		VkCommandPoolCreateInfo PoolInfo = {};
+		PoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		PoolInfo.queueFamilyIndex = QueueFamilyIndices[0];
+		PoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		if (vkCreateCommandPool(device, &Pool_ShortLivedInfo, nullptr, &Pool_ShortLived) != VK_SUCCESS) {
+			Pool_ShortLived = VK_NULL_HANDLE;
+			throw vkcl::util::Exception("Failed to create Staging Command Pool");
+		}
+
+		if (vkCreateCommandPool(device, &PoolInfo, nullptr, &Pool) != VK_SUCCESS) {
+			Pool = VK_NULL_HANDLE;
+			throw vkcl::util::Exception("Failed to create Command Pool");
+		}
+
+		// Create the buffer allocator
+		VmaAllocatorCreateInfo allocatorInfo = {};
+		allocatorInfo.physicalDevice = PhysicalDevice;
+		allocatorInfo.device = device;
+		allocatorInfo.instance = instance;
+		allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_2;
+
+		// Memory has to be allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT before buffers in it have an address
+		SupportsBufferAddresses = BufferAddresses && (AddressExtension ? vkGetBufferDeviceAddressKHR : vkGetBufferDeviceAddress) != nullptr;
+		if (SupportsBufferAddresses)
+			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+
+		if (SupportsMemoryBudget)
+			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
+		if (vmaCreateAllocator(&allocatorInfo, &allocator) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to create allocator!");
+		}
+
+		// The budget is checked against the heap device local buffers end up in
+		VmaAllocationCreateInfo DeviceAllocInfo = {};
+		DeviceAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		uint32_t DeviceType;
+		if (vmaFindMemoryTypeIndex(allocator, UINT32_MAX, &DeviceAllocInfo, &DeviceType) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to find device local memory");
+		}
+
+		const VkPhysicalDeviceMemoryProperties *MemProps;
+		vmaGetMemoryProperties(allocator, &MemProps);
+		DeviceHeap = MemProps->memoryTypes[DeviceType].heapIndex;
+
+		// integrated GPUs and resizable BAR setups can map their device local memory
+		VmaAllocationCreateInfo UnifiedAllocInfo = {};
+		UnifiedAllocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		uint32_t UnifiedType;
+		UnifiedMemory = vmaFindMemoryTypeIndex(allocator, UINT32_MAX, &UnifiedAllocInfo, &UnifiedType) == VK_SUCCESS &&
+			MemProps->memoryTypes[UnifiedType].heapIndex == DeviceHeap;
+
+		// where that memory is cached as well, as on integrated GPUs and CPU implementations, the host reads it as fast
+		// as the device does and every buffer is mapped instead of going through the staging ring
+		UnifiedAllocInfo.requiredFlags |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		ZeroCopy = vmaFindMemoryTypeIndex(allocator, UINT32_MAX, &UnifiedAllocInfo, &UnifiedType) == VK_SUCCESS &&
+			MemProps->memoryTypes[UnifiedType].heapIndex == DeviceHeap;
+		policy = BudgetPolicy::FailFast;
+		threshold = 1.0f;
+
+		// Recycled fences for every submission made on this device
+		fences = new FencePool;
+		fences->Load(device);
+
+		// Descriptor sets for every shader and command list
+		descriptors = new DescriptorAllocator;
+		descriptors->Load(device, fences);
+
+		descriptorcache = new DescriptorCache;
+		descriptorcache->Load(device, descriptors, fences, DescriptorCacheSize);
+
+		// Every buffer made on this device, Delete frees the ones still outstanding
+		buffers = new util::SlotMap<Buffer>;
+		imports = new std::map<char *, util::SlotHandle>;
+
+		// Small buffers are sub-allocated from a few large ones
+		bufferpool = new BufferPool;
+		bufferpool->Load(allocator, BufferUsage(), QueueFamilyIndices, BufferAlignment(), ZeroCopy);
+
+		// Transient buffers are bump allocated and freed an epoch at a time
+		arena = new BufferArena;
+		arena->Load(allocator, BufferUsage(), QueueFamilyIndices, BufferAlignment(), ZeroCopy, ArenaDefaultSize, ArenaDefaultEpochs);
+
+		// Staging ring shared by all uploads and downloads
+		staging = new StagingRing;
+		staging->Load(device, allocator, fences, Pool_ShortLived, QueueFamilyIndices, StagingDefaultSize);
+
+		// Pipeline cache, only kept in memory until a file is set
+		pipelinecache = new PipelineCache;
+		pipelinecache->Load(device, PhysicalDeviceProps);
+
+		// Large grids are split with vkCmdDispatchBase, which needs every pipeline to allow it
+		SupportsDispatchBase = PhysicalDeviceProps.apiVersion >= VK_API_VERSION_1_1 && vkCmdDispatchBase != nullptr;
+
+		// Descriptor writes go through update templates, or skip descriptor sets entirely with push descriptors
+		SupportsUpdateTemplates = PhysicalDeviceProps.apiVersion >= VK_API_VERSION_1_1 && vkUpdateDescriptorSetWithTemplate != nullptr;
+
+		MaxPushDescriptors = 0;
+		if (PushDescriptors && vkCmdPushDescriptorSetWithTemplateKHR != nullptr && vkGetPhysicalDeviceProperties2 != nullptr) {
+			VkPhysicalDevicePushDescriptorPropertiesKHR PushProps = {};
+			PushProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+
+			VkPhysicalDeviceProperties2 Props2 = {};
+			Props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			Props2.pNext = &PushProps;
+			vkGetPhysicalDeviceProperties2(PhysicalDevice, &Props2);
+
+			MaxPushDescriptors = PushProps.maxPushDescriptors;
+		}
+
+		// host allocations also have to be importable into buffers of the usage every buffer gets
+		if (SupportsHostImport && vkGetPhysicalDeviceExternalBufferProperties != nullptr) {
+			VkPhysicalDeviceExternalBufferInfo ExternalBufferInfo = {};
+			ExternalBufferInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_BUFFER_INFO;
+			ExternalBufferInfo.usage = BufferUsage();
+			ExternalBufferInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+			VkExternalBufferProperties ExternalBufferProps = {};
+			ExternalBufferProps.sType = VK_STRUCTURE_TYPE_EXTERNAL_BUFFER_PROPERTIES;
+			vkGetPhysicalDeviceExternalBufferProperties(PhysicalDevice, &ExternalBufferInfo, &ExternalBufferProps);
+
+			SupportsHostImport = (ExternalBufferProps.externalMemoryProperties.externalMemoryFeatures & VK_EXTERNAL_MEMORY_FEATURE_IMPORTABLE_BIT) != 0;
+		}
+
+		HostImportAlignment = 0;
+		if (SupportsHostImport && vkGetMemoryHostPointerPropertiesEXT != nullptr) {
+			VkPhysicalDeviceExternalMemoryHostPropertiesEXT HostProps = {};
+			HostProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+
+			VkPhysicalDeviceProperties2 Props2 = {};
+			Props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			Props2.pNext = &HostProps;
+			vkGetPhysicalDeviceProperties2(PhysicalDevice, &Props2);
+
+			HostImportAlignment = HostProps.minImportedHostPointerAlignment;
+		}
+		SupportsHostImport = HostImportAlignment != 0;
+
+		variants = new VariantCache;
+		variants->Load(device, pipelinecache, SupportsDispatchBase ? VK_PIPELINE_CREATE_DISPATCH_BASE_BIT : 0, SupportsUpdateTemplates, MaxPushDescriptors);
+	}
+
+	uint32_t Device::MemoryType(uint32_t Type, VkMemoryPropertyFlags Props)
+	{
+		VkPhysicalDeviceMemoryProperties MemProps;
+		
+		vkGetPhysicalDeviceMemoryProperties(this->PhysicalDevice, &MemProps);
+
+		for (uint32_t i = 0; i < MemProps.memoryTypeCount; ++i) {
+			if ((Type & (1 << i)) && ((MemProps.memoryTypes[i].propertyFlags & Props) == Props))
+				return i;
+		}
+
+		return -1;
+	}
+
+	void Device::Delete()
+	{
+		buffers->ForEach([this](Buffer *buffer) { DeleteBuffer(buffer); });
+		delete buffers;
+		delete imports;
+
+		bufferpool->Delete();
+		delete bufferpool;
+
+		arena->Delete();
+		delete arena;
+
+		staging->Delete();
+		delete staging;
+
+		descriptorcache->Delete();
+		delete descriptorcache;
+
+		descriptors->Delete();
+		delete descriptors;
+
+		fences->Delete();
+		delete fences;
+
+		variants->Delete();
+		delete variants;
+
+		pipelinecache->Delete();
+		delete pipelinecache;
+
+		vmaDestroyAllocator(allocator);
+
+		if (Pool_ShortLived != VK_NULL_HANDLE)
+			vkDestroyCommandPool(device, Pool_ShortLived, nullptr);
+		if (Pool != VK_NULL_HANDLE)
+			vkDestroyCommandPool(device, Pool, nullptr);
+		if (device != VK_NULL_HANDLE)
+			vkDestroyDevice(device, nullptr);
+	}
+
+	void Device::operator=(const Device &devb)
+	{
+		this->PhysicalDevice = devb.PhysicalDevice;
+		this->PhysicalDeviceProps = devb.PhysicalDeviceProps;
+		this->device = devb.device;
+		this->ComputeQueue = devb.ComputeQueue;
+		this->TransferQueue = devb.TransferQueue;
+		this->Pool_ShortLived = devb.Pool_ShortLived;
+		this->Pool = devb.Pool;
+		this->QueueFamilyIndices[0] = devb.QueueFamilyIndices[0];
+		this->QueueFamilyIndices[1] = devb.QueueFamilyIndices[1];
+		this->SupportsDispatchBase = devb.SupportsDispatchBase;
+		this->SupportsUpdateTemplates = devb.SupportsUpdateTemplates;
+		this->MaxPushDescriptors = devb.MaxPushDescriptors;
+		this->SupportsBufferAddresses = devb.SupportsBufferAddresses;
+		this->SupportsMemoryBudget = devb.SupportsMemoryBudget;
+		this->SupportsHostImport = devb.SupportsHostImport;
+		this->HostImportAlignment = devb.HostImportAlignment;
+		this->DeviceHeap = devb.DeviceHeap;
+		this->UnifiedMemory = devb.UnifiedMemory;
+		this->ZeroCopy = devb.ZeroCopy;
+		this->policy = devb.policy;
+		this->threshold = devb.threshold;
+		this->allocator = devb.allocator;
+		this->fences = devb.fences;
+		this->staging = devb.staging;
+		this->pipelinecache = devb.pipelinecache;
+		this->variants = devb.variants;
+		this->descriptors = devb.descriptors;
+		this->bufferpool = devb.bufferpool;
+		this->buffers = devb.buffers;
+		this->imports = devb.imports;
+		this->arena = devb.arena;
+		this->descriptorcache = devb.descriptorcache;
+	}
+
+	std::vector<Device> QueryAllDevices()
+	{
+		std::vector<vkcl::Device> devices;
+
+		try {
+			if (!vkinstance.getLoaded())
+				vkinstance.Load();
+			
+			std::vector<VkPhysicalDevice> physdevs = QueryPhysicalDevices(vkinstance.get());
+			devices.resize(physdevs.size());
+
+			for (uint32_t i = 0; i < physdevs.size(); i++) {
+				vkcl::Device device(vkinstance.get(), physdevs[i]);
+				device.setId(i);
+				devices[i] = device;
+			}
+
+		} catch (vkcl::util::Exception &e) {
+			vkcl::util::libLogger.Error(e.getMsg());
+		}
+
+		return devices;
+	}
+	
+
+	// Buffer Operations
+
+	void Device::CreateVKBuffer(VkDeviceSize size, VkBufferUsageFlags usageflags, VmaMemoryUsage memusage, VkBuffer &buffer, VmaAllocation &allocation, VmaAllocationInfo *allocinfo)
+	{
+		uint32_t *families = getQueueFamilyIndices();
+
+		VkBufferCreateInfo BufferCreateInfo = {};
+		BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		BufferCreateInfo.size = size;
+		BufferCreateInfo.usage = usageflags;
+		SetSharingMode(BufferCreateInfo, families);
+
+		VmaAllocationCreateInfo VbAllocInfo = LocalAllocation(ZeroCopy);
+		if (memusage != VMA_MEMORY_USAGE_GPU_ONLY) {
+			VbAllocInfo = {};
+			VbAllocInfo.usage = memusage;
+			VbAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		}
+
+		if (vmaCreateBuffer(this->allocator, &BufferCreateInfo, &VbAllocInfo, &buffer, &allocation, allocinfo) != VK_SUCCESS) {
+			buffer = VK_NULL_HANDLE;
+			allocation = VK_NULL_HANDLE;
+			throw vkcl::util::Exception("Failed to allocate " + std::to_string(size) + " bytes of buffer memory");
+		}
+	}
+
+	VkDeviceSize Device::BufferAlignment()
+	{
+		return std::max(PhysicalDeviceProps.limits.minStorageBufferOffsetAlignment, PhysicalDeviceProps.limits.minUniformBufferOffsetAlignment);
+	}
+
+	VkBufferUsageFlags Device::BufferUsage()
+	{
+		VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+		if (SupportsBufferAddresses)
+			usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+		return usage;
+	}
+
+	void Device::CopyVKBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize srcoffset, VkDeviceSize dstoffset, VkDeviceSize size, StagingSpan &span)
+	{
+		VkCommandBuffer cmdbuf = span.commandbuffer;
+
+		VkCommandBufferBeginInfo begininfo = {};
+		begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begininfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(cmdbuf, &begininfo);
+
+		// VK COMMANDS START
+
+		// Transfers are asynchronous, order this copy after the ones submitted before it
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy copyregion = {};
+		copyregion.srcOffset = srcoffset;
+		copyregion.dstOffset = dstoffset;
+		copyregion.size = size;
+		vkCmdCopyBuffer(cmdbuf, src, dst, 1, &copyregion);
+
+		// VK COMMANDS END
+
+		vkEndCommandBuffer(cmdbuf);
+
+		VkSubmitInfo submitinfo = {};
+		submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitinfo.commandBufferCount = 1;
+		submitinfo.pCommandBuffers = &cmdbuf;
+
+		// a span that was never submitted hands its fence back on retire instead of waiting for it
+		if (vkQueueSubmit(getTransferQueue(), 1, &submitinfo, span.fence) != VK_SUCCESS) {
+			fences->Release(span.submission);
+			throw vkcl::util::Exception(std::string("Failed to submit transfer operation"));
+		}
+
+		span.submitted = true;
+	}
+
+
+	Buffer *Device::CreateBuffer(VkDeviceSize size, MemoryUsage usage)
+	{
+		Buffer buf = {};
+
+		VmaMemoryUsage memusage = VMA_MEMORY_USAGE_GPU_ONLY;
+		if (usage == MemoryUsage::CPUToGPU || (usage == MemoryUsage::Auto && UnifiedMemory))
+			memusage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+		else if (usage == MemoryUsage::GPUToCPU)
+			memusage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+
+		// Only what goes to the device heap counts against the budget. A pooled buffer only adds to it when the pool
+		// has to grow by a whole block.
+		bool pooled = size <= BufferPoolMaxSize && memusage == VMA_MEMORY_USAGE_GPU_ONLY;
+		VkDeviceSize growth = !pooled ? size : bufferpool->Available(size) ? 0 : BufferPoolBlockSize;
+		if ((usage == MemoryUsage::GPUOnly || usage == MemoryUsage::Auto) && growth && !MakeRoom(growth)) {
+			memusage = VMA_MEMORY_USAGE_CPU_ONLY;
+			pooled = false;
+		}
+
+		// small buffers share a VkBuffer with others from the pool, descriptors and copies use their range of it
+		if (pooled) {
+			PoolRange range = bufferpool->Allocate(size);
+			buf.devbuffer = range.buffer;
+			buf.devalloc = range.alloc;
+			buf.offset = range.offset;
+			buf.sizeclass = range.sizeclass;
+			vmaGetAllocationInfo(allocator, buf.devalloc, &buf.devinfo);
+		} else {
+			CreateVKBuffer(size, BufferUsage(), memusage, buf.devbuffer, buf.devalloc, &buf.devinfo);
+			buf.offset = 0;
+			buf.sizeclass = UINT32_MAX;
+		}
+		buf.size = size;
+
+		return InsertBuffer(buf);
+	}
+
+	Buffer *Device::CreateTransientBuffer(VkDeviceSize size)
+	{
+		// the arena allocates the regions of every epoch on first use, a spilled arena leaves it to CreateBuffer
+		bool room = arena->get() != VK_NULL_HANDLE || MakeRoom(arena->getSize() * arena->getEpochs());
+
+		VkDeviceSize offset;
+		if (!room || !arena->Allocate(size, offset)) {
+			// the epoch outgrew its region or the arena didn't fit in the budget, a regular buffer still goes away with the epoch
+			Buffer *buffer = CreateBuffer(size);
+			arena->Track(buffer->handle);
+			return buffer;
+		}
+
+		Buffer buf = {};
+		buf.devbuffer = arena->get();
+		buf.devalloc = arena->getAllocation();
+		vmaGetAllocationInfo(allocator, buf.devalloc, &buf.devinfo);
+		buf.offset = offset;
+		buf.size = size;
+		buf.sizeclass = UINT32_MAX;
+		buf.transient = true;
+
+		Buffer *buffer = InsertBuffer(buf);
+		arena->Track(buffer->handle);
+
+		return buffer;
+	}
+
+	std::vector<Buffer *> Device::CreateAliasedBuffers(const std::vector<AliasedBufferDesc> &batch)
+	{
+		VkDeviceSize alignment = BufferAlignment();
+		std::vector<VkDeviceSize> offsets(batch.size());
+		std::vector<size_t> placed;
+
+		// largest first, each buffer goes into the lowest gap left by the placed buffers that are alive at the same time
+		std::vector<size_t> order(batch.size());
+		for (size_t i = 0; i < batch.size(); i++)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&batch](size_t a, size_t b) { return batch[a].size > batch[b].size; });
+
+		VkDeviceSize total = 0;
+		for (size_t i : order) {
+			if (batch[i].first > batch[i].last) {
+				throw vkcl::util::Exception("Aliased buffer ends before it starts");
+			}
+
+			std::vector<size_t> live;
+			for (size_t j : placed) {
+				if (batch[j].first <= batch[i].last && batch[i].first <= batch[j].last)
+					live.push_back(j);
+			}
+			std::sort(live.begin(), live.end(), [&offsets](size_t a, size_t b) { return offsets[a] < offsets[b]; });
+
+			VkDeviceSize offset = 0;
+			for (size_t j : live) {
+				if (offset + batch[i].size <= offsets[j])
+					break;
+				offset = std::max(offset, (offsets[j] + batch[j].size + alignment - 1) & ~(alignment - 1));
+			}
+
+			offsets[i] = offset;
+			placed.push_back(i);
+			total = std::max(total, offset + batch[i].size);
+		}
+
+		if (batch.empty())
+			return {};
+
+		VmaMemoryUsage memusage = MakeRoom(total) ? VMA_MEMORY_USAGE_GPU_ONLY : VMA_MEMORY_USAGE_CPU_ONLY;
+
+		AliasGroup *group = new AliasGroup;
+		group->memory = {};
+		group->memory.size = total;
+		group->memory.sizeclass = UINT32_MAX;
+		group->refs = batch.size();
+		try {
+			CreateVKBuffer(total, BufferUsage(), memusage, group->memory.devbuffer, group->memory.devalloc, &group->memory.devinfo);
+		} catch (...) {
+			delete group;
+			throw;
+		}
+
+		std::vector<Buffer *> aliased(batch.size());
+		for (size_t i = 0; i < batch.size(); i++) {
+			Buffer buf = {};
+			buf.devbuffer = group->memory.devbuffer;
+			buf.devalloc = group->memory.devalloc;
+			buf.devinfo = group->memory.devinfo;
+			buf.offset = offsets[i];
+			buf.size = batch[i].size;
+			buf.sizeclass = UINT32_MAX;
+			buf.group = group;
+
+			aliased[i] = InsertBuffer(buf);
+		}
+
+		return aliased;
+	}
+
+	Buffer *Device::ImportHostMemory(void *data, VkDeviceSize size)
+	{
+		if (!SupportsHostImport) {
+			throw vkcl::util::Exception("Device does not support importing host memory");
+		}
+
+		if ((uintptr_t)data % HostImportAlignment || size % HostImportAlignment || size == 0) {
+			throw vkcl::util::Exception("Imported host memory has to be aligned to " + std::to_string(HostImportAlignment) + " bytes");
+		}
+
+		VkMemoryHostPointerPropertiesEXT HostPointerProps = {};
+		HostPointerProps.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+		if (vkGetMemoryHostPointerPropertiesEXT(device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, data, &HostPointerProps) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Host memory can't be imported");
+		}
+
+		VkExternalMemoryBufferCreateInfo ExternalInfo = {};
+		ExternalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+		ExternalInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+		uint32_t *families = getQueueFamilyIndices();
+
+		VkBufferCreateInfo BufferCreateInfo = {};
+		BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		BufferCreateInfo.pNext = &ExternalInfo;
+		BufferCreateInfo.size = size;
+		BufferCreateInfo.usage = BufferUsage();
+		SetSharingMode(BufferCreateInfo, families);
+
+		Buffer buf = {};
+		if (vkCreateBuffer(device, &BufferCreateInfo, nullptr, &buf.devbuffer) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to create buffer for imported host memory");
+		}
+
+		VkMemoryRequirements MemReqs;
+		vkGetBufferMemoryRequirements(device, buf.devbuffer, &MemReqs);
+
+		uint32_t type = MemoryType(MemReqs.memoryTypeBits & HostPointerProps.memoryTypeBits, 0);
+		if (type == UINT32_MAX) {
+			vkDestroyBuffer(device, buf.devbuffer, nullptr);
+			throw vkcl::util::Exception("No memory type can hold imported host memory");
+		}
+
+		// buffers with an address need memory that was allocated for it
+		VkMemoryAllocateFlagsInfo FlagsInfo = {};
+		FlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+		FlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+		VkImportMemoryHostPointerInfoEXT ImportInfo = {};
+		ImportInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+		ImportInfo.pNext = SupportsBufferAddresses ? &FlagsInfo : nullptr;
+		ImportInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+		ImportInfo.pHostPointer = data;
+
+		VkMemoryAllocateInfo AllocInfo = {};
+		AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		AllocInfo.pNext = &ImportInfo;
+		AllocInfo.allocationSize = size;
+		AllocInfo.memoryTypeIndex = type;
+
+		if (vkAllocateMemory(device, &AllocInfo, nullptr, &buf.imported) != VK_SUCCESS || vkBindBufferMemory(device, buf.devbuffer, buf.imported, 0) != VK_SUCCESS) {
+			vkDestroyBuffer(device, buf.devbuffer, nullptr);
+			if (buf.imported != VK_NULL_HANDLE)
+				vkFreeMemory(device, buf.imported, nullptr);
+			throw vkcl::util::Exception("Failed to import host memory");
+		}
+
+		buf.devalloc = VK_NULL_HANDLE;
+		buf.devinfo.pMappedData = data; // the memory is the caller's, it is as mapped as it gets
+		buf.offset = 0;
+		buf.size = size;
+		buf.sizeclass = UINT32_MAX;
+
+		Buffer *buffer = InsertBuffer(buf);
+		(*imports)[(char *)data] = buffer->handle;
+
+		return buffer;
+	}
+
+	Buffer *Device::FindImport(void *data, VkDeviceSize size, VkDeviceSize &offset)
+	{
+		// the last import starting at or before data is the only one that can hold it
+		auto it = imports->upper_bound((char *)data);
+		if (it == imports->begin())
+			return nullptr;
+		it--;
+
+		Buffer *buffer = buffers->Get(it->second);
+		offset = (char *)data - it->first;
+		if (!buffer || offset + size > buffer->size)
+			return nullptr;
+
+		return buffer;
+	}
+
+	Buffer *Device::InsertBuffer(Buffer &buf)
+	{
+		buf.address = SupportsBufferAddresses ? DeviceAddress(buf.devbuffer) + buf.offset : 0;
+		buf.mapped = buf.devinfo.pMappedData ? (char *)buf.devinfo.pMappedData + buf.offset : nullptr;
+		buf.transfer = 0;
+		buf.compute.clear();
+		buf.state = {};
+
+		// the buffer only gets a slot once nothing can throw anymore
+		Buffer *slot = buffers->Insert(buf.handle);
+		*slot = buf;
+
+		return slot;
+	}
+
+	VkDeviceAddress Device::DeviceAddress(VkBuffer buffer)
+	{
+		VkBufferDeviceAddressInfo addressinfo = {};
+		addressinfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		addressinfo.buffer = buffer;
+		if (PhysicalDeviceProps.apiVersion >= VK_API_VERSION_1_2)
+			return vkGetBufferDeviceAddress(device, &addressinfo);
+
+		return vkGetBufferDeviceAddressKHR(device, &addressinfo);
+	}
+
+	bool Device::WithinBudget(VkDeviceSize size)
+	{
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+		vmaGetBudget(allocator, budgets);
+
+		return budgets[DeviceHeap].usage + size <= budgets[DeviceHeap].budget * threshold;
+	}
+
+	bool Device::MakeRoom(VkDeviceSize size)
+	{
+		if (WithinBudget(size))
+			return true;
+
+		if (policy != BudgetPolicy::FailFast) {
+			TrimMemory();
+			if (WithinBudget(size))
+				return true;
+		}
+
+		if (policy == BudgetPolicy::Spill)
+			return false;
+
+		throw vkcl::util::Exception("Allocating " + std::to_string(size) + " bytes of device memory would exceed the memory budget");
+	}
+
+	std::vector<HeapBudget> Device::GetMemoryBudget()
+	{
+		const VkPhysicalDeviceMemoryProperties *MemProps;
+		vmaGetMemoryProperties(allocator, &MemProps);
+
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+		vmaGetBudget(allocator, budgets);
+
+		std::vector<HeapBudget> heaps(MemProps->memoryHeapCount);
+		for (uint32_t i = 0; i < MemProps->memoryHeapCount; i++) {
+			heaps[i].budget = budgets[i].budget;
+			heaps[i].usage = budgets[i].usage;
+			heaps[i].allocated = budgets[i].allocationBytes;
+			heaps[i].flags = MemProps->memoryHeaps[i].flags;
+		}
+
+		return heaps;
+	}
+
+	void Device::SetBudgetPolicy(BudgetPolicy policy, float threshold)
+	{
+		this->policy = policy;
+		this->threshold = threshold;
+	}
+
+	VkDeviceSize Device::TrimMemory()
+	{
+		VkDeviceSize freed = bufferpool->Trim();
+
+		// the arena can only go once none of its buffers are left, it comes back on the next transient buffer
+		bool used = false;
+		for (auto handle : arena->Tracked()) {
+			if (buffers->Get(handle))
+				used = true;
+		}
+		if (!used)
+			freed += arena->Release();
+
+		return freed;
+	}
+
+	VkDeviceSize Device::Compact()
+	{
+		// nothing may touch the buffers while their memory moves
+		staging->Flush();
+		vkDeviceWaitIdle(device);
+
+		VkDeviceSize freed = TrimMemory();
+
+		// every allocation that holds buffers, pool blocks and the arena included, along with the VkBuffer bound to it
+		std::unordered_map<VmaAllocation, size_t> index;
+		std::vector<VmaAllocation> allocations;
+		std::vector<VkBuffer> bound;
+		std::vector<VkDeviceSize> sizes;
+		buffers->ForEach([&](Buffer *buffer) {
+			Buffer *tracked = Tracked(buffer);
+			if (buffer->imported || !index.emplace(tracked->devalloc, allocations.size()).second)
+				return;
+
+			allocations.push_back(tracked->devalloc);
+			bound.push_back(tracked->devbuffer);
+			if (buffer->sizeclass != UINT32_MAX)
+				sizes.push_back(BufferPoolBlockSize);
+			else if (buffer->transient)
+				sizes.push_back(arena->getSize() * arena->getEpochs());
+			else
+				sizes.push_back(tracked->size);
+		});
+
+		if (allocations.empty())
+			return freed;
+
+		VkCommandBufferAllocateInfo cmdbufinfo = {};
+		cmdbufinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdbufinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cmdbufinfo.commandPool = getShortCommandPool();
+		cmdbufinfo.commandBufferCount = 1;
+
+		VkCommandBuffer cmdbuf;
+		if (vkAllocateCommandBuffers(device, &cmdbufinfo, &cmdbuf) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to allocate command buffer for compaction");
+		}
+
+		VkCommandBufferBeginInfo begininfo = {};
+		begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begininfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(cmdbuf, &begininfo);
+
+		// pAllocationsChanged isn't filled in reliably, moved allocations are found by where they were before
+		std::vector<VmaAllocationInfo> before(allocations.size());
+		for (size_t i = 0; i < allocations.size(); i++)
+			vmaGetAllocationInfo(allocator, allocations[i], &before[i]);
+
+		// device local memory is copied on the transfer queue, host visible memory is moved on the CPU
+		VmaDefragmentationInfo2 defraginfo = {};
+		defraginfo.allocationCount = allocations.size();
+		defraginfo.pAllocations = allocations.data();
+		defraginfo.maxCpuBytesToMove = VK_WHOLE_SIZE;
+		defraginfo.maxCpuAllocationsToMove = UINT32_MAX;
+		defraginfo.maxGpuBytesToMove = VK_WHOLE_SIZE;
+		defraginfo.maxGpuAllocationsToMove = UINT32_MAX;
+		defraginfo.commandBuffer = cmdbuf;
+
+		VmaDefragmentationStats stats = {};
+		VmaDefragmentationContext context;
+		VkResult result = vmaDefragmentationBegin(allocator, &defraginfo, &stats, &context);
+		vkEndCommandBuffer(cmdbuf);
+
+		if (result == VK_NOT_READY) {
+			VkSubmitInfo submitinfo = {};
+			submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitinfo.commandBufferCount = 1;
+			submitinfo.pCommandBuffers = &cmdbuf;
+
+			VkFence fence;
+			Submission submission = fences->Acquire(fence);
+			if (vkQueueSubmit(getTransferQueue(), 1, &submitinfo, fence) != VK_SUCCESS) {
+				fences->Release(submission);
+				vmaDefragmentationEnd(allocator, context);
+				vkFreeCommandBuffers(device, getShortCommandPool(), 1, &cmdbuf);
+				throw vkcl::util::Exception("Failed to submit compaction");
+			}
+			fences->Wait(submission);
+		}
+
+		vmaDefragmentationEnd(allocator, context);
+		vkFreeCommandBuffers(device, getShortCommandPool(), 1, &cmdbuf);
+
+		if (result != VK_SUCCESS && result != VK_NOT_READY) {
+			throw vkcl::util::Exception("Failed to compact buffer memory");
+		}
+
+		// buffers are bound to their memory for good, the moved ones are recreated and bound where the memory went
+		uint32_t *families = getQueueFamilyIndices();
+		std::vector<VkBuffer> rebound(allocations.size(), VK_NULL_HANDLE);
+		bool failed = false;
+		for (size_t i = 0; i < allocations.size(); i++) {
+			VmaAllocationInfo after;
+			vmaGetAllocationInfo(allocator, allocations[i], &after);
+			if (after.deviceMemory == before[i].deviceMemory && after.offset == before[i].offset)
+				continue;
+
+			VkBufferCreateInfo BufferCreateInfo = {};
+			BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			BufferCreateInfo.size = sizes[i];
+			BufferCreateInfo.usage = BufferUsage();
+			SetSharingMode(BufferCreateInfo, families);
+
+			// The memory has already moved, the old buffers no longer point at it. A failure can't be undone, every
+			// other allocation is still rebound and the buffers of the failed ones are only good for DeleteBuffer.
+			VkResult status = vkCreateBuffer(device, &BufferCreateInfo, nullptr, &rebound[i]);
+			if (status == VK_SUCCESS)
+				status = vmaBindBufferMemory(allocator, allocations[i], rebound[i]);
+
+			if (status != VK_SUCCESS) {
+				if (rebound[i] != VK_NULL_HANDLE)
+					vkDestroyBuffer(device, rebound[i], nullptr);
+				rebound[i] = VK_NULL_HANDLE;
+				failed = true;
+			}
+		}
+
+		buffers->ForEach([&](Buffer *buffer) {
+			if (buffer->imported)
+				return;
+
+			size_t i = index[Tracked(buffer)->devalloc];
+			if (rebound[i] == VK_NULL_HANDLE)
+				return;
+
+			// sets written with the old buffer are gone for good, binding the buffer again writes a new one
+			descriptorcache->Invalidate(buffer->devbuffer, buffer->offset);
+
+			buffer->devbuffer = rebound[i];
+			vmaGetAllocationInfo(allocator, buffer->devalloc, &buffer->devinfo);
+			buffer->address = SupportsBufferAddresses ? DeviceAddress(buffer->devbuffer) + buffer->offset : 0;
+			buffer->mapped = buffer->devinfo.pMappedData ? (char *)buffer->devinfo.pMappedData + buffer->offset : nullptr;
+			if (buffer->group) {
+				buffer->group->memory.devbuffer = rebound[i];
+				buffer->group->memory.devinfo = buffer->devinfo;
+			}
+		});
+
+		for (size_t i = 0; i < allocations.size(); i++) {
+			if (rebound[i] == VK_NULL_HANDLE)
+				continue;
+
+			vkDestroyBuffer(device, bound[i], nullptr);
+			bufferpool->Rebind(bound[i], rebound[i]);
+			arena->Rebind(bound[i], rebound[i]);
+		}
+
+		if (failed) {
+			throw vkcl::util::Exception("Failed to rebind compacted buffer memory, the buffers that were in it have to be deleted");
+		}
+
+		return freed + stats.bytesFreed;
+	}
+
+	void Device::NextEpoch()
+	{
+		// the region coming up was last used epochs ago, its buffers are freed once the work using them has completed
+		for (auto handle : arena->Advance()) {
+			Buffer *buffer = buffers->Get(handle);
+			if (buffer)
+				DeleteBuffer(buffer);
+		}
+	}
+
+	void Device::SetTransientSize(VkDeviceSize size, uint32_t epochs)
+	{
+		for (uint32_t i = 0; i < arena->getEpochs(); i++)
+			NextEpoch();
+
+		arena->Delete();
+		arena->Load(allocator, BufferUsage(), QueueFamilyIndices, BufferAlignment(), ZeroCopy, size, epochs);
+	}
+
+	void Device::DeleteBuffer(Buffer *buffer)
+	{
+		// catches buffers of other devices, and deleted ones whose slot hasn't been reused yet. Once it has, a stale
+		// pointer aliases the new buffer, only the handle tells them apart, see GetBuffer
+		if (buffers->Get(buffer->handle) != buffer) {
+			throw vkcl::util::Exception("Buffer was already deleted or belongs to another device");
+		}
+
+		staging->Retire(Tracked(buffer)->transfer);
+		fences->Wait(Tracked(buffer)->compute);
+		descriptorcache->Invalidate(buffer->devbuffer, buffer->offset);
+
+		// transient buffers give their memory back when their epoch's region is reset
+		if (buffer->group) {
+			if (--buffer->group->refs == 0) {
+				vmaDestroyBuffer(allocator, buffer->group->memory.devbuffer, buffer->group->memory.devalloc);
+				delete buffer->group;
+			}
+		} else if (buffer->imported) {
+			imports->erase((char *)buffer->mapped);
+			vkDestroyBuffer(device, buffer->devbuffer, nullptr);
+			vkFreeMemory(device, buffer->imported, nullptr);
+		} else if (buffer->sizeclass != UINT32_MAX)
+			bufferpool->Free({ buffer->devbuffer, buffer->devalloc, buffer->offset, buffer->sizeclass });
+		else if (!buffer->transient)
+			vmaDestroyBuffer(allocator, buffer->devbuffer, buffer->devalloc);
+		buffers->Remove(buffer->handle);
+	}
+
+	Buffer *Device::GetBuffer(util::SlotHandle handle)
+	{
+		return buffers->Get(handle);
+	}
+
+	VkDeviceAddress Device::BufferAddress(Buffer *buffer)
+	{
+		if (!SupportsBufferAddresses) {
+			throw vkcl::util::Exception("Device does not support buffer device addresses");
+		}
+
+		return buffer->address;
+	}
+
+	void Device::UploadData(Buffer *buffer, void *data)
+	{
+		Wait(UploadDataAsync(buffer, data));
+	}
+
+	void *Device::DownloadData(Buffer *buffer)
+	{
+		void *data = malloc(buffer->size);
+
+		Wait(DownloadDataAsync(buffer, data));
+
+		return data;
+	}
+
+	Transfer Device::UploadDataAsync(Buffer *buffer, void *data)
+	{
+		fences->Wait(Tracked(buffer)->compute);
+
+		// imported data is copied by the transfer queue without a staging copy, the span only tracks the copy
+		VkDeviceSize imported;
+		Buffer *source = FindImport(data, buffer->size, imported);
+		if (source == buffer)
+			return Transfer { Tracked(buffer)->transfer };
+
+		if (source) {
+			fences->Wait(source->compute);
+
+			StagingSpan &span = staging->Acquire(0);
+			CopyVKBuffer(source->devbuffer, buffer->devbuffer, imported, buffer->offset, buffer->size, span);
+			Tracked(buffer)->transfer = source->transfer = span.id;
+			Tracked(buffer)->state = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, 0, 0 };
+
+			// the copy still reads data, which the caller may overwrite as soon as this returns
+			staging->Retire(span.id);
+
+			return Transfer { span.id };
+		}
+
+		// mapped buffers are written in place, submitting work that reads them makes the write visible
+		if (buffer->mapped) {
+			staging->Retire(Tracked(buffer)->transfer);
+			std::memcpy(buffer->mapped, data, buffer->size);
+			if (buffer->devalloc) // imported memory isn't the allocator's to flush
+				vmaFlushAllocation(allocator, buffer->devalloc, buffer->offset, buffer->size);
+			Tracked(buffer)->state = {};
+
+			return Transfer { Tracked(buffer)->transfer };
+		}
+
+		VkDeviceSize size = buffer->size;
+		VkDeviceSize chunk = staging->Chunk(size);
+
+		// Transfers larger than the staging ring are split up, filling one chunk while the previous one is copied
+		for (VkDeviceSize offset = 0; offset < size; offset += chunk) {
+			VkDeviceSize len = std::min(chunk, size - offset);
+
+			StagingSpan &span = staging->Acquire(len);
+			std::memcpy(span.mapped, (char *)data + offset, len);
+			CopyVKBuffer(staging->get(), buffer->devbuffer, span.offset, buffer->offset + offset, len, span);
+			Tracked(buffer)->transfer = span.id;
+		}
+
+		// compute work is only submitted once the copy has finished, but the write still has to be made visible to it
+		Tracked(buffer)->state = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, 0, 0 };
+
+		return Transfer { Tracked(buffer)->transfer };
+	}
+
+	Transfer Device::DownloadDataAsync(Buffer *buffer, void *data)
+	{
+		fences->Wait(Tracked(buffer)->compute);
+
+		VkDeviceSize imported;
+		Buffer *target = FindImport(data, buffer->size, imported);
+		if (target == buffer)
+			return Transfer { Tracked(buffer)->transfer };
+
+		if (target) {
+			fences->Wait(target->compute);
+
+			StagingSpan &span = staging->Acquire(0);
+			CopyVKBuffer(buffer->devbuffer, target->devbuffer, buffer->offset, imported, buffer->size, span);
+			Tracked(buffer)->transfer = target->transfer = span.id;
+
+			return Transfer { span.id };
+		}
+
+		// and read in place, cached memory has to be invalidated first
+		if (buffer->mapped) {
+			staging->Retire(Tracked(buffer)->transfer);
+			if (buffer->devalloc)
+				vmaInvalidateAllocation(allocator, buffer->devalloc, buffer->offset, buffer->size);
+			std::memcpy(data, buffer->mapped, buffer->size);
+
+			return Transfer { Tracked(buffer)->transfer };
+		}
+
+		VkDeviceSize size = buffer->size;
+		VkDeviceSize chunk = staging->Chunk(size);
+
+		// Spans are copied into data as they retire, so earlier chunks are read back while later ones are in flight
+		for (VkDeviceSize offset = 0; offset < size; offset += chunk) {
+			VkDeviceSize len = std::min(chunk, size - offset);
+
+			StagingSpan &span = staging->Acquire(len);
+			span.readback = (char *)data + offset;
+			CopyVKBuffer(buffer->devbuffer, staging->get(), buffer->offset + offset, span.offset, len, span);
+			Tracked(buffer)->transfer = span.id;
+		}
+
+		return Transfer { Tracked(buffer)->transfer };
+	}
+
+	void Device::Wait(Transfer transfer)
+	{
+		staging->Retire(transfer.id);
+	}
+
+	bool Device::Poll(Transfer transfer)
+	{
+		return staging->Poll(transfer.id);
+	}
+
+	void Device::SetStagingSize(VkDeviceSize size)
+	{
+		staging->Delete();
+		staging->Load(device, allocator, fences, Pool_ShortLived, QueueFamilyIndices, size);
+	}
+
+	void Device::ReleaseData(void *data)
+	{
+		free(data);
+	}
+
+	void *Device::Map(Buffer *buffer)
+	{
+		if (!buffer->mapped)
+			return nullptr;
+
+		staging->Retire(Tracked(buffer)->transfer);
+		fences->Wait(Tracked(buffer)->compute);
+		if (buffer->devalloc)
+			vmaInvalidateAllocation(allocator, buffer->devalloc, buffer->offset, buffer->size);
+
+		return buffer->mapped;
+	}
+
+	void Device::Unmap(Buffer *buffer)
+	{
+		if (!buffer->mapped)
+			return;
+
+		if (buffer->devalloc)
+			vmaFlushAllocation(allocator, buffer->devalloc, buffer->offset, buffer->size);
+		Tracked(buffer)->state = {};
+	}
+
+	
+	// Compute Operations
+
+	Shader *Device::CreateShader(const std::string fp, const std::vector<SpecConstant> &specialization)
+	{
+		return CompileShader(fp, 0, 0, specialization);
+	}
+
+	Shader *Device::CreateShader(const std::string fp, size_t BufferCount, uint32_t PushConstantSize, const std::vector<SpecConstant> &specialization)
+	{
+		return CompileShader(fp, BufferCount, PushConstantSize, specialization);
+	}
+
+	std::vector<Shader *> Device::CreateShaders(const std::vector<ShaderDesc> &batch, unsigned threads)
+	{
+		std::vector<Shader *> shaders(batch.size(), nullptr);
+		std::vector<std::exception_ptr> errors(batch.size());
+
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		threads = std::min<size_t>(threads, batch.size());
+
+		// workers take the next shader in the batch until it is done, the pipeline cache is shared between them
+		std::atomic<size_t> next(0);
+		auto worker = [&]() {
+			for (size_t i = next++; i < batch.size(); i = next++) {
+				try {
+					shaders[i] = CompileShader(batch[i].fp, batch[i].BufferCount, batch[i].PushConstantSize, batch[i].specialization);
+				} catch (...) {
+					errors[i] = std::current_exception();
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (unsigned i = 0; i < threads; i++)
+			workers.push_back(std::thread(worker));
+		for (auto &t : workers)
+			t.join();
+
+		for (auto &error : errors) {
+			if (!error)
+				continue;
+
+			for (auto shader : shaders) {
+				if (shader)
+					DeleteShader(shader);
+			}
+
+			std::rethrow_exception(error);
+		}
+
+		return shaders;
+	}
+
+	std::future<Shader *> Device::CreateShaderAsync(const std::string fp, size_t BufferCount, uint32_t PushConstantSize, const std::vector<SpecConstant> &specialization)
+	{
+		// the copy shares the device's pools and pipeline cache
+		Device dev = *this;
+		return std::async(std::launch::async, [dev, fp, BufferCount, PushConstantSize, specialization]() mutable {
+			return dev.CompileShader(fp, BufferCount, PushConstantSize, specialization);
+		});
+	}
+
+	Shader *Device::CompileShader(const std::string fp, size_t BufferCount, uint32_t PushConstantSize, const std::vector<SpecConstant> &specialization)
+	{
+		// Load shader code
+		uint32_t len = 0;
+		uint32_t *code = nullptr;
+		
+		try { 
+			code = GetSpv(&len, fp);
+		} catch (vkcl::util::Exception& e) {
+			throw e;
+		}
+
+		if (!code)
+			throw vkcl::util::Exception("Could not load shader code");
+
+		std::vector<uint32_t> spirv(code, code + len / sizeof(uint32_t));
+		free(code);
+
+		ShaderReflection reflection = ReflectShader(spirv.data(), spirv.size());
+		std::vector<ShaderBinding> bindings;
+
+		if (BufferCount == 0) {
+			for (auto &binding : reflection.bindings) {
+				if (binding.set != 0) {
+					throw vkcl::util::Exception(fp + ": only descriptor set 0 is supported");
+				}
+
+				if ((binding.type != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER && binding.type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) || binding.count != 1) {
+					throw vkcl::util::Exception(fp + ": binding " + std::to_string(binding.binding) + " is not a single storage or uniform buffer");
+				}
+			}
+
+			bindings = reflection.bindings;
+			if (PushConstantSize == 0)
+				PushConstantSize = reflection.PushConstantSize;
+		} else {
+			// bindings 0 to BufferCount - 1 are storage buffers, the module has to agree
+			for (size_t i = 0; i < BufferCount; i++)
+				bindings.push_back({ 0, (uint32_t)i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, false });
+
+			for (auto &binding : reflection.bindings) {
+				if (binding.set != 0 || binding.binding >= BufferCount || binding.type != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || binding.count != 1) {
+					throw vkcl::util::Exception(fp + ": set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding) + " does not match " + std::to_string(BufferCount) + " storage buffers");
+				}
+
+				bindings[binding.binding].readonly = binding.readonly;
+			}
+		}
+
+		if (reflection.PushConstantSize > PushConstantSize) {
+			throw vkcl::util::Exception(fp + ": push constant block is " + std::to_string(reflection.PushConstantSize) + " bytes, larger than " + std::to_string(PushConstantSize));
+		}
+
+		if (PushConstantSize % 4 != 0 || PushConstantSize > PhysicalDeviceProps.limits.maxPushConstantsSize) {
+			throw vkcl::util::Exception("Push constant size has to be a multiple of 4 and fit in maxPushConstantsSize");
+		}
+
+		// dispatches are sized in workgroups of this many invocations
+		uint32_t LocalSize[3];
+		for (int i = 0; i < 3; i++) {
+			LocalSize[i] = reflection.LocalSize[i];
+			for (auto &constant : specialization) {
+				if (constant.id == reflection.LocalSizeId[i])
+					LocalSize[i] = constant.value;
+			}
+
+			if (LocalSize[i] == 0) {
+				throw vkcl::util::Exception(fp + ": workgroup size is 0 in dimension " + std::to_string(i));
+			}
+		}
+
+		// module, layouts and pipeline are shared with every shader using the same code and constants
+		ShaderVariant *variant = variants->Acquire(spirv, bindings, PushConstantSize, specialization);
+
+		Shader *shader = new Shader;
+		shader->BufferCount = bindings.size();
+		shader->PushConstantSize = PushConstantSize;
+		shader->bindings = bindings;
+		shader->variant = variant;
+		shader->shadermod = variant->shadermod;
+		shader->layout = variant->layout;
+		shader->pipelinelayout = variant->pipelinelayout;
+		shader->pipeline = variant->pipeline;
+
+		std::memcpy(shader->LocalSize, LocalSize, sizeof(LocalSize));
+
+		shader->set = nullptr;
+
+		// command buffers come from the shared command pool, which can only be used from one thread at a time
+		shader->commandbuffer = VK_NULL_HANDLE;
+		shader->inflight.clear();
+		shader->dirty = true;
+
+		return shader;
+	}
+
+	void Device::DeleteShader(Shader *shader)
+	{
+		fences->Wait(shader->inflight);
+
+		if (shader->commandbuffer != VK_NULL_HANDLE)
+			vkFreeCommandBuffers(device, getCommandPool(), 1, &shader->commandbuffer);
+
+		for (auto &commands : shader->retired)
+			vkFreeCommandBuffers(device, getCommandPool(), 1, &commands.commandbuffer);
+
+		for (auto &prologue : shader->prologues)
+			vkFreeCommandBuffers(device, getCommandPool(), 1, &prologue.commandbuffer);
+
+		variants->Release(shader->variant);
+		if (shader->set)
+			descriptorcache->Release(shader->set);
+
+		delete shader;
+	}
+
+	void Device::SetPipelineCacheFile(const std::string fp)
+	{
+		pipelinecache->SetFile(fp);
+	}
+
+	void Device::SavePipelineCache()
+	{
+		pipelinecache->Save();
+	}
+
+	void Device::TrimShaderVariants()
+	{
+		variants->Trim();
+	}
+
+	void Device::BindBuffers(Shader *shader, Buffer **buffers)
+	{
+		std::vector<VkDescriptorBufferInfo> bufferinfo(shader->BufferCount);
+		for (size_t i = 0; i < shader->BufferCount; i++)
+			bufferinfo[i] = { buffers[i]->devbuffer, buffers[i]->offset, buffers[i]->size };
+
+		// buffers given to UseBuffers follow the bound ones and stay in use
+		std::vector<Buffer *> addressed(shader->buffers.begin() + shader->bufferinfo.size(), shader->buffers.end());
+		shader->buffers.assign(buffers, buffers + shader->BufferCount);
+		shader->buffers.insert(shader->buffers.end(), addressed.begin(), addressed.end());
+
+		// push descriptors are written into the command buffer when it is recorded, there is no set to look up
+		if (shader->variant->push) {
+			shader->dirty = shader->dirty || bufferinfo.size() != shader->bufferinfo.size() ||
+				std::memcmp(bufferinfo.data(), shader->bufferinfo.data(), bufferinfo.size() * sizeof(VkDescriptorBufferInfo));
+			shader->bufferinfo = bufferinfo;
+			return;
+		}
+
+		// cached sets are never rewritten, so binding doesn't have to wait for submissions still using the old one
+		DescriptorEntry *set = descriptorcache->Acquire(shader->layout, shader->bindings, bufferinfo, shader->variant->update);
+		if (shader->set)
+			descriptorcache->Release(shader->set);
+
+		shader->dirty = shader->dirty || set != shader->set; // the recorded command buffer binds the old set
+		shader->set = set;
+		shader->bufferinfo = bufferinfo;
+	}
+
+	void Device::UseBuffers(Shader *shader, Buffer **buffers, size_t count)
+	{
+		// barriers are placed at submission, the recorded commands don't depend on the buffers used
+		shader->buffers.resize(shader->bufferinfo.size());
+		shader->buffers.insert(shader->buffers.end(), buffers, buffers + count);
+	}
+
+	VkAccessFlags Device::ShaderAccess(Shader *shader, Buffer *buffer)
+	{
+		// read only bindings never need to be waited on by later reads, buffers reached through addresses might be written
+		VkAccessFlags access = VK_ACCESS_SHADER_READ_BIT;
+		for (size_t i = 0; i < shader->buffers.size(); i++) {
+			if (shader->buffers[i] == buffer && (i >= shader->bindings.size() || !shader->bindings[i].readonly))
+				access |= VK_ACCESS_SHADER_WRITE_BIT;
+		}
+
+		return access;
+	}
+
+	void Device::RecordGrid(VkCommandBuffer cmdbuf, uint32_t x, uint32_t y, uint32_t z)
+	{
+		const uint32_t *max = PhysicalDeviceProps.limits.maxComputeWorkGroupCount;
+		if (x <= max[0] && y <= max[1] && z <= max[2]) {
+			vkCmdDispatch(cmdbuf, x, y, z);
+			return;
+		}
+
+		if (!SupportsDispatchBase) {
+			throw vkcl::util::Exception("Dispatch is larger than maxComputeWorkGroupCount and the device can't offset workgroups");
+		}
+
+		// gl_WorkGroupID keeps counting across the pieces, gl_NumWorkGroups only covers the current one
+		for (uint64_t bz = 0; bz < z; bz += max[2]) {
+			for (uint64_t by = 0; by < y; by += max[1]) {
+				for (uint64_t bx = 0; bx < x; bx += max[0]) {
+					vkCmdDispatchBase(cmdbuf, bx, by, bz, std::min<uint64_t>(max[0], x - bx), std::min<uint64_t>(max[1], y - by), std::min<uint64_t>(max[2], z - bz));
+				}
+			}
+		}
+	}
+
+	Submission Device::Dispatch1D(Shader *shader, uint32_t x, const void *constants)
+	{
+		return Dispatch3D(shader, x, 1, 1, constants);
+	}
+
+	Submission Device::Dispatch2D(Shader *shader, uint32_t x, uint32_t y, const void *constants)
+	{
+		return Dispatch3D(shader, x, y, 1, constants);
+	}
+
+	Submission Device::Dispatch3D(Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants)
+	{
+		uint32_t groups[3];
+		uint32_t elements[3] = { x, y, z };
+		for (int i = 0; i < 3; i++)
+			groups[i] = elements[i] / shader->LocalSize[i] + (elements[i] % shader->LocalSize[i] != 0);
+
+		return Submit(shader, groups[0], groups[1], groups[2], constants);
+	}
+
+	void Device::RunShader(Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants)
+	{
+		Wait(Submit(shader, x, y, z, constants));
+	}
+
+	void Device::RecordShader(Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants)
+	{
+		if (shader->bufferinfo.size() != shader->BufferCount) {
+			throw vkcl::util::Exception("Shader has no buffers bound");
+		}
+
+		// a pending command buffer can't be re-recorded, it is swapped for a new one and freed once it has completed
+		if (shader->commandbuffer != VK_NULL_HANDLE && !fences->Poll(shader->inflight)) {
+			shader->retired.push_back({ shader->inflight, shader->commandbuffer });
+			shader->commandbuffer = VK_NULL_HANDLE;
+			shader->inflight.clear();
+		}
+
+		while (!shader->retired.empty() && fences->Poll(shader->retired.front().submissions)) {
+			vkFreeCommandBuffers(device, getCommandPool(), 1, &shader->retired.front().commandbuffer);
+			shader->retired.pop_front();
+		}
+
+		if (shader->commandbuffer == VK_NULL_HANDLE) {
+			VkCommandBufferAllocateInfo commandbufferinfo = {};
+			commandbufferinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			commandbufferinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			commandbufferinfo.commandPool = getCommandPool();
+			commandbufferinfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device, &commandbufferinfo, &shader->commandbuffer) != VK_SUCCESS) {
+				throw vkcl::util::Exception(std::string("Failed to allocate command buffer for compute operation")); 
+			}
+		}
+
+		VkCommandBufferBeginInfo begininfo = {};
+		begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begininfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; // replayed until the shader changes
+		vkBeginCommandBuffer(shader->commandbuffer, &begininfo);
+
+		// VK COMMANDS START
+
+		vkCmdBindPipeline(shader->commandbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, shader->pipeline);
+		if (shader->variant->push)
+			vkCmdPushDescriptorSetWithTemplateKHR(shader->commandbuffer, shader->variant->update, shader->pipelinelayout, 0, shader->bufferinfo.data());
+		else if (shader->BufferCount)
+			vkCmdBindDescriptorSets(shader->commandbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, shader->pipelinelayout, 0, 1, &shader->set->set.handle, 0, nullptr);
+		if (shader->PushConstantSize)
+			vkCmdPushConstants(shader->commandbuffer, shader->pipelinelayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, shader->PushConstantSize, constants);
+		RecordGrid(shader->commandbuffer, x, y, z);
+
+		// VK COMMANDS END
+
+		vkEndCommandBuffer(shader->commandbuffer);
+
+		shader->constants.assign((const char *)constants, (const char *)constants + shader->PushConstantSize);
+		shader->recorded[0] = x;
+		shader->recorded[1] = y;
+		shader->recorded[2] = z;
+		shader->dirty = false;
+	}
+
+	Submission Device::Submit(Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants)
+	{
+		if (shader->PushConstantSize && !constants) {
+			throw vkcl::util::Exception("Shader was created with push constants but none were given");
+		}
+
+		// Transfers run on their own queue, make sure none are still writing to or reading from the bound buffers
+		for (auto &buffer : shader->buffers)
+			staging->Retire(Tracked(buffer)->transfer);
+
+		// Repeated dispatches replay the previous recording
+		if (shader->dirty || shader->recorded[0] != x || shader->recorded[1] != y || shader->recorded[2] != z ||
+		    (shader->PushConstantSize && std::memcmp(shader->constants.data(), constants, shader->PushConstantSize) != 0))
+			RecordShader(shader, x, y, z, constants);
+
+		BarrierBatch hazards;
+		for (auto it = shader->buffers.begin(); it != shader->buffers.end(); it++) {
+			if (std::find(shader->buffers.begin(), it, *it) == it)
+				hazards.Access((*it)->devbuffer, (*it)->offset, (*it)->size, Tracked(*it)->state, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, ShaderAccess(shader, *it));
+		}
+
+		// Only the barriers the tracked state calls for go in front of a replay, independent dispatches overlap
+		VkCommandBuffer commandbuffers[2] = { VK_NULL_HANDLE, shader->commandbuffer };
+		Prologue *prologue = nullptr;
+		if (!hazards.empty()) {
+			// the barriers differ from one submission to the next, every pending submission keeps its own
+			auto it = std::find_if(shader->prologues.begin(), shader->prologues.end(), [this](Prologue &p) { return fences->Poll(p.submission); });
+			if (it == shader->prologues.end()) {
+				VkCommandBufferAllocateInfo commandbufferinfo = {};
+				commandbufferinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				commandbufferinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				commandbufferinfo.commandPool = getCommandPool();
+				commandbufferinfo.commandBufferCount = 1;
+
+				VkCommandBuffer commandbuffer;
+				if (vkAllocateCommandBuffers(device, &commandbufferinfo, &commandbuffer) != VK_SUCCESS) {
+					throw vkcl::util::Exception(std::string("Failed to allocate command buffer for compute operation"));
+				}
+
+				shader->prologues.push_back({ { UINT32_MAX, 0 }, commandbuffer });
+				it = shader->prologues.end() - 1;
+			}
+
+			prologue = &*it;
+
+			VkCommandBufferBeginInfo begininfo = {};
+			begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			begininfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(prologue->commandbuffer, &begininfo);
+			hazards.Record(prologue->commandbuffer);
+			vkEndCommandBuffer(prologue->commandbuffer);
+			commandbuffers[0] = prologue->commandbuffer;
+		}
+
+		VkSubmitInfo submitinfo = {};
+		submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitinfo.commandBufferCount = prologue ? 2 : 1;
+		submitinfo.pCommandBuffers = prologue ? commandbuffers : &commandbuffers[1];
+
+		VkFence fence;
+		Submission submission = fences->Acquire(fence);
+
+		if (vkQueueSubmit(getComputeQueue(), 1, &submitinfo, fence) != VK_SUCCESS) {
+			fences->Release(submission);
+			throw vkcl::util::Exception("Failed to submit compute operation");
+		}
+
+		if (prologue)
+			prologue->submission = submission;
+
+		// dispatches without a barrier between them can complete in any order, each one is waited for on its own
+		fences->Track(shader->inflight, submission);
+		for (auto &buffer : shader->buffers)
+			fences->Track(Tracked(buffer)->compute, submission);
+		if (shader->set)
+			descriptorcache->Use(shader->set, submission);
+
+		return submission;
+	}
+
+	void Device::Wait(Submission submission)
+	{
+		fences->Wait(submission);
+	}
+
+	bool Device::Poll(Submission submission)
+	{
+		return fences->Poll(submission);
+	}
+
+	// Command Lists
+
+	CommandList *Device::CreateCommandList()
+	{
+		CommandList *list = new CommandList;
+
+		VkCommandBufferAllocateInfo commandbufferinfo = {};
+		commandbufferinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		commandbufferinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		commandbufferinfo.commandPool = getCommandPool();
+		commandbufferinfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(device, &commandbufferinfo, &list->commandbuffer) != VK_SUCCESS) {
+			throw vkcl::util::Exception(std::string("Failed to allocate command buffer for command list"));
+		}
+
+		if (vkAllocateCommandBuffers(device, &commandbufferinfo, &list->prologue) != VK_SUCCESS) {
+			throw vkcl::util::Exception(std::string("Failed to allocate command buffer for command list"));
+		}
+
+		list->recording = false;
+		list->inflight = { UINT32_MAX, 0 };
+
+		return list;
+	}
+
+	void Device::DeleteCommandList(CommandList *list)
+	{
+		fences->Wait(list->inflight);
+
+		for (auto &block : list->staging)
+			vmaDestroyBuffer(allocator, block.buffer, block.alloc);
+
+		for (auto set : list->sets)
+			descriptorcache->Release(set);
+
+		vkFreeCommandBuffers(device, getCommandPool(), 1, &list->commandbuffer);
+		vkFreeCommandBuffers(device, getCommandPool(), 1, &list->prologue);
+
+		delete list;
+	}
+
+	void Device::BeginList(CommandList *list)
+	{
+		if (list->recording)
+			return;
+
+		// finish the previous use of the list before its command buffer and staging memory are reused
+		Wait(list);
+
+		// Staging blocks added during the last recording are merged, so a list that is reused settles on one block
+		if (list->staging.size() > 1) {
+			VkDeviceSize total = 0;
+
+			for (auto &block : list->staging) {
+				total += block.size;
+				vmaDestroyBuffer(allocator, block.buffer, block.alloc);
+			}
+
+			StagingBlock block = {};
+			block.size = total;
+			CreateVKBuffer(total, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_ONLY, block.buffer, block.alloc, &block.info);
+
+			list->staging.clear();
+			list->staging.push_back(block);
+		}
+
+		for (auto &block : list->staging)
+			block.used = 0;
+
+		list->accesses.clear();
+		list->shaders.clear();
+
+		for (auto set : list->sets)
+			descriptorcache->Release(set);
+		list->sets.clear();
+
+		VkCommandBufferBeginInfo begininfo = {};
+		begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begininfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(list->commandbuffer, &begininfo);
+
+		list->recording = true;
+	}
+
+	void *Device::StageList(CommandList *list, VkDeviceSize size, VkBuffer &buffer, VkDeviceSize &offset)
+	{
+		VkDeviceSize reserved = (size + StagingAlignment - 1) & ~(StagingAlignment - 1);
+
+		if (list->staging.empty() || list->staging.back().used + reserved > list->staging.back().size) {
+			StagingBlock block = {};
+			block.size = std::max(reserved, list->staging.empty() ? StagingAlignment * 4096 : list->staging.back().size * 2);
+			block.used = 0;
+			CreateVKBuffer(block.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_ONLY, block.buffer, block.alloc, &block.info);
+
+			list->staging.push_back(block);
+		}
+
+		StagingBlock &block = list->staging.back();
+		buffer = block.buffer;
+		offset = block.used;
+		block.used += reserved;
+
+		return (char *)block.info.pMappedData + offset;
+	}
+
+	void Device::AccessList(CommandList *list, Buffer *buffer, VkPipelineStageFlags stage, VkAccessFlags access)
+	{
+		Buffer *tracked = Tracked(buffer);
+		auto entry = std::find_if(list->accesses.begin(), list->accesses.end(), [tracked](const ListAccess &a) { return a.buffer == tracked; });
+		if (entry == list->accesses.end()) {
+			list->accesses.push_back({ tracked, {}, 0, 0, false });
+			entry = list->accesses.end() - 1;
+		}
+
+		// Hazards inside the list are resolved while recording, the ones against earlier submissions on submit
+		if (!entry->written) {
+			entry->firststage |= stage;
+			entry->firstaccess |= access;
+			entry->written = (access & (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT)) != 0;
+		}
+
+		list->barriers.Access(buffer->devbuffer, buffer->offset, buffer->size, entry->state, stage, access);
+	}
+
+	void Device::RecordUpload(CommandList *list, Buffer *buffer, void *data)
+	{
+		BeginList(list);
+		AccessList(list, buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		list->barriers.Record(list->commandbuffer);
+
+		VkBuffer src;
+		VkDeviceSize srcoffset;
+		void *mapped = StageList(list, buffer->size, src, srcoffset);
+		std::memcpy(mapped, data, buffer->size);
+
+		VkBufferCopy copyregion = {};
+		copyregion.srcOffset = srcoffset;
+		copyregion.dstOffset = buffer->offset;
+		copyregion.size = buffer->size;
+		vkCmdCopyBuffer(list->commandbuffer, src, buffer->devbuffer, 1, &copyregion);
+	}
+
+	void Device::RecordDispatch(CommandList *list, Shader *shader, uint32_t x, uint32_t y, uint32_t z, const void *constants)
+	{
+		if (shader->PushConstantSize && !constants) {
+			throw vkcl::util::Exception("Shader was created with push constants but none were given");
+		}
+
+		if (shader->bufferinfo.size() != shader->BufferCount) {
+			throw vkcl::util::Exception("Shader has no buffers bound");
+		}
+
+		BeginList(list);
+
+		for (auto it = shader->buffers.begin(); it != shader->buffers.end(); it++) {
+			if (std::find(shader->buffers.begin(), it, *it) == it)
+				AccessList(list, *it, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, ShaderAccess(shader, *it));
+		}
+		list->barriers.Record(list->commandbuffer);
+
+		vkCmdBindPipeline(list->commandbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, shader->pipeline);
+		// the list holds on to the set, so the shader can be rebound before the list has run
+		if (shader->variant->push) {
+			vkCmdPushDescriptorSetWithTemplateKHR(list->commandbuffer, shader->variant->update, shader->pipelinelayout, 0, shader->bufferinfo.data());
+		} else if (shader->BufferCount) {
+			descriptorcache->Retain(shader->set);
+			list->sets.push_back(shader->set);
+
+			vkCmdBindDescriptorSets(list->commandbuffer, VK_PIPELINE_BIND_POINT_COMPUTE, shader->pipelinelayout, 0, 1, &shader->set->set.handle, 0, nullptr);
+		}
+		if (shader->PushConstantSize)
+			vkCmdPushConstants(list->commandbuffer, shader->pipelinelayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, shader->PushConstantSize, constants);
+		RecordGrid(list->commandbuffer, x, y, z);
+
+		if (std::find(list->shaders.begin(), list->shaders.end(), shader) == list->shaders.end())
+			list->shaders.push_back(shader);
+	}
+
+	void Device::RecordDownload(CommandList *list, Buffer *buffer, void *data)
+	{
+		BeginList(list);
+		AccessList(list, buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+		list->barriers.Record(list->commandbuffer);
+
+		VkBuffer dst;
+		VkDeviceSize dstoffset;
+		void *mapped = StageList(list, buffer->size, dst, dstoffset);
+		list->readbacks.push_back({ data, mapped, buffer->size });
+
+		VkBufferCopy copyregion = {};
+		copyregion.srcOffset = buffer->offset;
+		copyregion.dstOffset = dstoffset;
+		copyregion.size = buffer->size;
+		vkCmdCopyBuffer(list->commandbuffer, buffer->devbuffer, dst, 1, &copyregion);
+	}
+
+	Submission Device::Submit(CommandList *list)
+	{
+		if (!list->recording)
+			return list->inflight;
+
+		// readbacks were recorded as transfer writes to host visible memory
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(list->commandbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkEndCommandBuffer(list->commandbuffer);
+		list->recording = false;
+
+		// Transfers run on their own queue, make sure none are still writing to or reading from the list's buffers
+		for (auto &entry : list->accesses)
+			staging->Retire(entry.buffer->transfer);
+
+		// Barriers against earlier submissions go into the prologue, then the list's own end state becomes the buffers' state
+		BarrierBatch hazards;
+		for (auto &entry : list->accesses) {
+			hazards.Access(entry.buffer->devbuffer, entry.buffer->offset, entry.buffer->size, entry.buffer->state, entry.firststage, entry.firstaccess);
+
+			if (entry.written)
+				entry.buffer->state = entry.state;
+		}
+
+		VkCommandBuffer commandbuffers[2] = { list->prologue, list->commandbuffer };
+
+		if (!hazards.empty()) {
+			VkCommandBufferBeginInfo begininfo = {};
+			begininfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			begininfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(list->prologue, &begininfo);
+			hazards.Record(list->prologue);
+			vkEndCommandBuffer(list->prologue);
+		}
+
+		VkSubmitInfo submitinfo = {};
+		submitinfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitinfo.commandBufferCount = hazards.empty() ? 1 : 2;
+		submitinfo.pCommandBuffers = hazards.empty() ? &commandbuffers[1] : commandbuffers;
+
+		VkFence fence;
+		Submission submission = fences->Acquire(fence);
+
+		if (vkQueueSubmit(getComputeQueue(), 1, &submitinfo, fence) != VK_SUCCESS) {
+			fences->Release(submission);
+			throw vkcl::util::Exception("Failed to submit command list");
+		}
+
+		list->inflight = submission;
+		for (auto &entry : list->accesses)
+			fences->Track(entry.buffer->compute, submission);
+		for (auto &shader : list->shaders)
+			fences->Track(shader->inflight, submission);
+		for (auto set : list->sets)
+			descriptorcache->Use(set, submission);
+
+		return submission;
+	}
+
+	void Device::Wait(CommandList *list)
+	{
+		if (list->recording)
+			return;
+
+		fences->Wait(list->inflight);
+
+		for (auto &readback : list->readbacks)
+			std::memcpy(readback.dst, readback.src, readback.size);
+
+		list->readbacks.clear();
+	}
+
+}
\ No newline at end of file
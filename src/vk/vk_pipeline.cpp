@@ -0,0 +1,447 @@
+#include <vkcl/vk_pipeline.h>
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+namespace vkcl {
+
+	static const char PipelineCacheMagic[8] = { 'V', 'K', 'C', 'L', 'P', 'C', '0', '1' };
+
+	static uint64_t HashData(const char *data, size_t size)
+	{
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= (uint8_t)data[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	void PipelineCache::Load(VkDevice device, const VkPhysicalDeviceProperties &props)
+	{
+		this->device = device;
+		this->props = props;
+
+		VkPipelineCacheCreateInfo cacheinfo = {};
+		cacheinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheinfo.initialDataSize = 0;
+		cacheinfo.pInitialData = nullptr;
+
+		if (vkCreatePipelineCache(device, &cacheinfo, nullptr, &cache) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to create pipeline cache");
+		}
+	}
+
+	void PipelineCache::Delete()
+	{
+		if (!file.empty())
+			Save();
+
+		vkDestroyPipelineCache(device, cache, nullptr);
+	}
+
+	bool PipelineCache::Matches(const PipelineCacheHeader &header)
+	{
+		if (std::memcmp(header.magic, PipelineCacheMagic, sizeof(PipelineCacheMagic)) != 0)
+			return false;
+
+		if (header.vendorID != props.vendorID || header.deviceID != props.deviceID || header.driverVersion != props.driverVersion)
+			return false;
+
+		return std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	bool PipelineCache::Validate(const PipelineCacheHeader &header, const char *data)
+	{
+		if (header.dataHash != HashData(data, header.dataSize))
+			return false;
+
+		// the driver's own header has to agree as well: length, version, vendorID, deviceID and the cache UUID
+		uint32_t driverheader[4];
+		if (header.dataSize < sizeof(driverheader) + VK_UUID_SIZE)
+			return false;
+
+		std::memcpy(driverheader, data, sizeof(driverheader));
+		if (driverheader[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || driverheader[2] != props.vendorID || driverheader[3] != props.deviceID)
+			return false;
+
+		return std::memcmp(data + sizeof(driverheader), props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	void PipelineCache::SetFile(const std::string fp)
+	{
+		file = fp;
+
+		FILE *f = fopen(fp.c_str(), "rb");
+		if (!f) {
+			vkcl::util::libLogger.Info(std::string("No pipeline cache at ") + fp + ", starting with an empty one");
+			return;
+		}
+
+		PipelineCacheHeader header;
+		std::vector<char> data;
+
+		bool valid = fread(&header, sizeof(header), 1, f) == 1 && Matches(header);
+
+		// dataSize is only trusted once the file is known to hold that much
+		if (valid) {
+			long start = ftell(f);
+			valid = start >= 0 && fseek(f, 0, SEEK_END) == 0;
+
+			long end = valid ? ftell(f) : -1;
+			valid = end >= start && header.dataSize > 0 && header.dataSize <= (uint64_t)(end - start) && fseek(f, start, SEEK_SET) == 0;
+		}
+
+		if (valid) {
+			data.resize(header.dataSize);
+			valid = fread(data.data(), header.dataSize, 1, f) == 1;
+		}
+
+		fclose(f);
+
+		if (!valid || !Validate(header, data.data())) {
+			vkcl::util::libLogger.Warn(std::string("Ignoring pipeline cache ") + fp + ", it is corrupt or was written for another device or driver");
+			return;
+		}
+
+		VkPipelineCacheCreateInfo cacheinfo = {};
+		cacheinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cacheinfo.initialDataSize = data.size();
+		cacheinfo.pInitialData = data.data();
+
+		VkPipelineCache loaded;
+		if (vkCreatePipelineCache(device, &cacheinfo, nullptr, &loaded) != VK_SUCCESS) {
+			vkcl::util::libLogger.Warn(std::string("Failed to create pipeline cache from ") + fp);
+			return;
+		}
+
+		// keep whatever was compiled before the file was set
+		vkMergePipelineCaches(device, loaded, 1, &cache);
+		vkDestroyPipelineCache(device, cache, nullptr);
+		cache = loaded;
+	}
+
+	void PipelineCache::Save()
+	{
+		if (file.empty())
+			return;
+
+		size_t size = 0;
+		if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0)
+			return;
+
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS)
+			return;
+
+		PipelineCacheHeader header = {};
+		std::memcpy(header.magic, PipelineCacheMagic, sizeof(PipelineCacheMagic));
+		header.vendorID = props.vendorID;
+		header.deviceID = props.deviceID;
+		header.driverVersion = props.driverVersion;
+		std::memcpy(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+		header.dataSize = size;
+		header.dataHash = HashData(data.data(), size);
+
+		// write to a temporary file first so a crash never leaves a truncated cache behind
+		std::string tmp = file + ".tmp";
+		FILE *f = fopen(tmp.c_str(), "wb");
+		if (!f) {
+			vkcl::util::libLogger.Warn(std::string("Could not write pipeline cache: ") + tmp);
+			return;
+		}
+
+		bool written = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(data.data(), size, 1, f) == 1;
+		written = (fclose(f) == 0) && written;
+
+		if (!written || rename(tmp.c_str(), file.c_str()) != 0) {
+			vkcl::util::libLogger.Warn(std::string("Could not write pipeline cache: ") + file);
+			remove(tmp.c_str());
+		}
+	}
+
+	void VariantCache::Load(VkDevice device, PipelineCache *pipelinecache, VkPipelineCreateFlags flags, bool templates, uint32_t pushdescriptors)
+	{
+		this->device = device;
+		this->pipelinecache = pipelinecache;
+		this->flags = flags;
+		this->templates = templates;
+		this->pushdescriptors = pushdescriptors;
+	}
+
+	void VariantCache::Delete()
+	{
+		for (auto &variant : variants)
+			DestroyVariant(variant.second);
+		for (auto &module : modules)
+			vkDestroyShaderModule(device, module.second.shadermod, nullptr);
+
+		variants.clear();
+		modules.clear();
+	}
+
+	VkShaderModule VariantCache::AcquireModule(uint64_t key, const std::vector<uint32_t> &code)
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			auto it = modules.find(key);
+			if (it != modules.end()) {
+				it->second.refs++;
+				return it->second.shadermod;
+			}
+		}
+
+		VkShaderModuleCreateInfo modcreateinfo = {};
+		modcreateinfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		modcreateinfo.pCode = code.data();
+		modcreateinfo.codeSize = code.size() * sizeof(uint32_t);
+
+		VkShaderModule shadermod;
+		if (vkCreateShaderModule(device, &modcreateinfo, NULL, &shadermod) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Could not allocate shader module");
+		}
+
+		// another thread may have created the same module in the meantime
+		std::lock_guard<std::mutex> guard(lock);
+		auto it = modules.find(key);
+		if (it != modules.end()) {
+			vkDestroyShaderModule(device, shadermod, nullptr);
+			it->second.refs++;
+			return it->second.shadermod;
+		}
+
+		modules[key] = { shadermod, 1 };
+		return shadermod;
+	}
+
+	ShaderVariant *VariantCache::CreateVariant(VkShaderModule shadermod, const std::vector<ShaderBinding> &bindings, uint32_t PushConstantSize, const std::vector<SpecConstant> &constants)
+	{
+		ShaderVariant *variant = new ShaderVariant;
+		variant->shadermod = shadermod;
+		variant->layout = VK_NULL_HANDLE;
+		variant->pipelinelayout = VK_NULL_HANDLE;
+		variant->pipeline = VK_NULL_HANDLE;
+		variant->update = VK_NULL_HANDLE;
+		variant->push = !bindings.empty() && bindings.size() <= pushdescriptors;
+		variant->refs = 1;
+
+		// whatever was created before a failure is destroyed again, destroying a null handle does nothing
+		try {
+			BuildVariant(variant, bindings, PushConstantSize, constants);
+		} catch (...) {
+			DestroyVariant(variant);
+			throw;
+		}
+
+		return variant;
+	}
+
+	void VariantCache::BuildVariant(ShaderVariant *variant, const std::vector<ShaderBinding> &bindings, uint32_t PushConstantSize, const std::vector<SpecConstant> &constants)
+	{
+
+		std::vector<VkDescriptorSetLayoutBinding> layoutbindings(bindings.size());
+		for (size_t i = 0; i < bindings.size(); i++) { // boiler plate code is for retards
+			layoutbindings[i] = {};
+			layoutbindings[i].binding = bindings[i].binding;
+			layoutbindings[i].descriptorType = bindings[i].type;
+			layoutbindings[i].descriptorCount = bindings[i].count;
+			layoutbindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			layoutbindings[i].pImmutableSamplers = nullptr;
+		}
+
+		// struct for holding layout bindings to create layout object
+		VkDescriptorSetLayoutCreateInfo layoutcreateinfo = {};
+		layoutcreateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutcreateinfo.bindingCount = layoutbindings.size();
+		layoutcreateinfo.pBindings = layoutbindings.data();
+		if (variant->push)
+			layoutcreateinfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+
+		if (vkCreateDescriptorSetLayout(device, &layoutcreateinfo, NULL, &variant->layout) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Could not create descriptor set layout");
+		}
+
+		// Create pipeline
+		VkPipelineLayoutCreateInfo pipelinelayoutcreateinfo = {};
+		pipelinelayoutcreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelinelayoutcreateinfo.pNext = nullptr;
+		pipelinelayoutcreateinfo.setLayoutCount = 1;
+		pipelinelayoutcreateinfo.pSetLayouts = &variant->layout;
+
+		VkPushConstantRange pushconstantrange = {};
+		pushconstantrange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushconstantrange.offset = 0;
+		pushconstantrange.size = PushConstantSize;
+
+		if (PushConstantSize) {
+			pipelinelayoutcreateinfo.pushConstantRangeCount = 1;
+			pipelinelayoutcreateinfo.pPushConstantRanges = &pushconstantrange;
+		}
+
+		if (vkCreatePipelineLayout(device, &pipelinelayoutcreateinfo, nullptr, &variant->pipelinelayout) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Could not create Compute Pipeline Layout");
+		}
+
+		// one entry per binding, reading the same VkDescriptorBufferInfo array the descriptor cache keys on
+		if ((templates || variant->push) && !bindings.empty()) {
+			std::vector<VkDescriptorUpdateTemplateEntry> templateentries(bindings.size());
+			for (size_t i = 0; i < bindings.size(); i++) {
+				templateentries[i] = {};
+				templateentries[i].dstBinding = bindings[i].binding;
+				templateentries[i].dstArrayElement = 0;
+				templateentries[i].descriptorCount = 1;
+				templateentries[i].descriptorType = bindings[i].type;
+				templateentries[i].offset = i * sizeof(VkDescriptorBufferInfo);
+				templateentries[i].stride = sizeof(VkDescriptorBufferInfo);
+			}
+
+			VkDescriptorUpdateTemplateCreateInfo templatecreateinfo = {};
+			templatecreateinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+			templatecreateinfo.descriptorUpdateEntryCount = templateentries.size();
+			templatecreateinfo.pDescriptorUpdateEntries = templateentries.data();
+			templatecreateinfo.templateType = variant->push ? VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR : VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+			templatecreateinfo.descriptorSetLayout = variant->layout;
+			templatecreateinfo.pipelineBindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+			templatecreateinfo.pipelineLayout = variant->pipelinelayout;
+			templatecreateinfo.set = 0;
+
+			if (vkCreateDescriptorUpdateTemplate(device, &templatecreateinfo, nullptr, &variant->update) != VK_SUCCESS) {
+				throw vkcl::util::Exception("Could not create descriptor update template");
+			}
+		}
+
+		// every constant is 4 bytes wide and laid out in the order it was given
+		std::vector<VkSpecializationMapEntry> entries(constants.size());
+		std::vector<uint32_t> data(constants.size());
+		for (size_t i = 0; i < constants.size(); i++) {
+			entries[i].constantID = constants[i].id;
+			entries[i].offset = i * sizeof(uint32_t);
+			entries[i].size = sizeof(uint32_t);
+			data[i] = constants[i].value;
+		}
+
+		VkSpecializationInfo specinfo = {};
+		specinfo.mapEntryCount = entries.size();
+		specinfo.pMapEntries = entries.data();
+		specinfo.dataSize = data.size() * sizeof(uint32_t);
+		specinfo.pData = data.data();
+
+		VkPipelineShaderStageCreateInfo shaderstagecreateinfo = {};
+		shaderstagecreateinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderstagecreateinfo.pNext = nullptr;
+		shaderstagecreateinfo.flags = VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT_EXT;
+		shaderstagecreateinfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		shaderstagecreateinfo.module = variant->shadermod;
+		shaderstagecreateinfo.pName = "main";
+		shaderstagecreateinfo.pSpecializationInfo = constants.empty() ? nullptr : &specinfo;
+
+		VkComputePipelineCreateInfo pipelinecreateinfo = {};
+		pipelinecreateinfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelinecreateinfo.pNext = nullptr;
+		pipelinecreateinfo.flags = flags;
+		pipelinecreateinfo.stage = shaderstagecreateinfo;
+		pipelinecreateinfo.layout = variant->pipelinelayout;
+
+		if (vkCreateComputePipelines(device, pipelinecache->get(), 1, &pipelinecreateinfo, nullptr, &variant->pipeline) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Could not create Compute Pipeline");
+		}
+	}
+
+	void VariantCache::DestroyVariant(ShaderVariant *variant)
+	{
+		vkDestroyPipeline(device, variant->pipeline, nullptr);
+		if (variant->update != VK_NULL_HANDLE)
+			vkDestroyDescriptorUpdateTemplate(device, variant->update, nullptr);
+		vkDestroyPipelineLayout(device, variant->pipelinelayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, variant->layout, nullptr);
+		delete variant;
+	}
+
+	ShaderVariant *VariantCache::Acquire(const std::vector<uint32_t> &code, const std::vector<ShaderBinding> &bindings, uint32_t PushConstantSize, const std::vector<SpecConstant> &constants)
+	{
+		// the same constants given in another order make the same variant
+		std::vector<SpecConstant> sorted = constants;
+		std::sort(sorted.begin(), sorted.end(), [](const SpecConstant &a, const SpecConstant &b) { return a.id < b.id; });
+
+		uint64_t module = HashData((const char *)code.data(), code.size() * sizeof(uint32_t));
+		VariantKey key(module, std::vector<uint32_t>(), PushConstantSize, std::vector<uint32_t>());
+		for (auto &binding : bindings) {
+			std::get<1>(key).push_back(binding.binding);
+			std::get<1>(key).push_back(binding.type);
+			std::get<1>(key).push_back(binding.count);
+		}
+		for (auto &constant : sorted) {
+			std::get<3>(key).push_back(constant.id);
+			std::get<3>(key).push_back(constant.value);
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			auto it = variants.find(key);
+			if (it != variants.end()) {
+				it->second->refs++;
+				return it->second;
+			}
+		}
+
+		// compile outside the lock so different variants build in parallel
+		VkShaderModule shadermod = AcquireModule(module, code);
+		ShaderVariant *variant;
+		try {
+			variant = CreateVariant(shadermod, bindings, PushConstantSize, sorted);
+		} catch (...) {
+			// the module is destroyed by Trim once nothing else uses it
+			std::lock_guard<std::mutex> guard(lock);
+			modules[module].refs--;
+			throw;
+		}
+		variant->module = module;
+
+		std::lock_guard<std::mutex> guard(lock);
+		auto it = variants.find(key);
+		if (it != variants.end()) {
+			DestroyVariant(variant);
+			modules[module].refs--;
+			it->second->refs++;
+			return it->second;
+		}
+
+		variants[key] = variant;
+		return variant;
+	}
+
+	void VariantCache::Release(ShaderVariant *variant)
+	{
+		// variants stay cached until Trim, so recreating a shader is cheap
+		std::lock_guard<std::mutex> guard(lock);
+		variant->refs--;
+	}
+
+	void VariantCache::Trim()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		for (auto it = variants.begin(); it != variants.end();) {
+			if (it->second->refs == 0) {
+				modules[it->second->module].refs--;
+				DestroyVariant(it->second);
+				it = variants.erase(it);
+			} else {
+				it++;
+			}
+		}
+
+		for (auto it = modules.begin(); it != modules.end();) {
+			if (it->second.refs == 0) {
+				vkDestroyShaderModule(device, it->second.shadermod, nullptr);
+				it = modules.erase(it);
+			} else {
+				it++;
+			}
+		}
+	}
+
+}
@@ -0,0 +1,252 @@
+#include <vkcl/vk_pool.h>
+
+#include <algorithm>
+
+namespace vkcl {
+
+	void BufferPool::Load(VmaAllocator allocator, VkBufferUsageFlags usage, uint32_t *families, VkDeviceSize alignment, bool mapped)
+	{
+		this->allocator = allocator;
+		this->usage = usage;
+		this->families[0] = families[0];
+		this->families[1] = families[1];
+		this->mapped = mapped;
+
+		minsize = 16;
+		while (minsize < alignment)
+			minsize <<= 1;
+
+		freelists.clear();
+		for (VkDeviceSize size = minsize; size <= BufferPoolMaxSize; size <<= 1)
+			freelists.push_back({});
+	}
+
+	void BufferPool::Delete()
+	{
+		for (auto &block : blocks)
+			vmaDestroyBuffer(allocator, block.buffer, block.alloc);
+
+		blocks.clear();
+		freelists.clear();
+	}
+
+	void BufferPool::Grow()
+	{
+		// hand out what is left of the current block in the largest pieces that fit
+		if (!blocks.empty()) {
+			Block &block = blocks.back();
+			for (uint32_t sizeclass = freelists.size(); sizeclass-- > 0;) {
+				while (BufferPoolBlockSize - block.used >= ClassSize(sizeclass)) {
+					freelists[sizeclass].push_back({ block.buffer, block.alloc, block.used, sizeclass });
+					block.used += ClassSize(sizeclass);
+				}
+			}
+		}
+
+		VkBufferCreateInfo BufferCreateInfo = {};
+		BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		BufferCreateInfo.size = BufferPoolBlockSize;
+		BufferCreateInfo.usage = usage;
+		SetSharingMode(BufferCreateInfo, families);
+
+		VmaAllocationCreateInfo BlockAllocInfo = LocalAllocation(mapped);
+
+		Block block = {};
+		if (vmaCreateBuffer(allocator, &BufferCreateInfo, &BlockAllocInfo, &block.buffer, &block.alloc, nullptr) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to create buffer pool block");
+		}
+
+		blocks.push_back(block);
+	}
+
+	PoolRange BufferPool::Allocate(VkDeviceSize size)
+	{
+		if (size > BufferPoolMaxSize) {
+			throw vkcl::util::Exception("Buffer is too large for the buffer pool");
+		}
+
+		uint32_t sizeclass = SizeClass(size);
+		std::vector<PoolRange> &freelist = freelists[sizeclass];
+		if (!freelist.empty()) {
+			PoolRange range = freelist.back();
+			freelist.pop_back();
+			Owner(range).live++;
+			return range;
+		}
+
+		if (blocks.empty() || BufferPoolBlockSize - blocks.back().used < ClassSize(sizeclass))
+			Grow();
+
+		Block &block = blocks.back();
+		PoolRange range = { block.buffer, block.alloc, block.used, sizeclass };
+		block.used += ClassSize(sizeclass);
+		block.live++;
+
+		return range;
+	}
+
+	bool BufferPool::Available(VkDeviceSize size)
+	{
+		if (size > BufferPoolMaxSize)
+			return false;
+
+		uint32_t sizeclass = SizeClass(size);
+		return !freelists[sizeclass].empty() || (!blocks.empty() && BufferPoolBlockSize - blocks.back().used >= ClassSize(sizeclass));
+	}
+
+	uint32_t BufferPool::SizeClass(VkDeviceSize size)
+	{
+		uint32_t sizeclass = 0;
+		while (ClassSize(sizeclass) < size)
+			sizeclass++;
+
+		return sizeclass;
+	}
+
+	void BufferPool::Free(const PoolRange &range)
+	{
+		Owner(range).live--;
+		freelists[range.sizeclass].push_back(range);
+	}
+
+	BufferPool::Block &BufferPool::Owner(const PoolRange &range)
+	{
+		// there are only ever a few blocks
+		for (auto &block : blocks) {
+			if (block.buffer == range.buffer)
+				return block;
+		}
+
+		throw vkcl::util::Exception("Range does not belong to this buffer pool");
+	}
+
+	void BufferPool::Rebind(VkBuffer from, VkBuffer to)
+	{
+		for (auto &block : blocks) {
+			if (block.buffer == from)
+				block.buffer = to;
+		}
+
+		for (auto &freelist : freelists) {
+			for (auto &range : freelist) {
+				if (range.buffer == from)
+					range.buffer = to;
+			}
+		}
+	}
+
+	VkDeviceSize BufferPool::Trim()
+	{
+		VkDeviceSize freed = 0;
+
+		for (auto it = blocks.begin(); it != blocks.end();) {
+			if (it->live) {
+				it++;
+				continue;
+			}
+
+			VkBuffer buffer = it->buffer;
+			for (auto &freelist : freelists)
+				freelist.erase(std::remove_if(freelist.begin(), freelist.end(), [buffer](const PoolRange &range) { return range.buffer == buffer; }), freelist.end());
+
+			vmaDestroyBuffer(allocator, it->buffer, it->alloc);
+			it = blocks.erase(it);
+			freed += BufferPoolBlockSize;
+		}
+
+		return freed;
+	}
+
+	void BufferArena::Load(VmaAllocator allocator, VkBufferUsageFlags usage, uint32_t *families, VkDeviceSize alignment, bool mapped, VkDeviceSize size, uint32_t epochs)
+	{
+		this->allocator = allocator;
+		this->usage = usage;
+		this->families[0] = families[0];
+		this->families[1] = families[1];
+		this->alignment = alignment;
+		this->mapped = mapped;
+		this->size = (size + alignment - 1) & ~(alignment - 1);
+		this->epochs = epochs ? epochs : 1;
+		this->current = 0;
+		this->used = 0;
+
+		buffer = VK_NULL_HANDLE;
+		tracked.assign(this->epochs, {});
+	}
+
+	void BufferArena::Delete()
+	{
+		if (buffer != VK_NULL_HANDLE)
+			vmaDestroyBuffer(allocator, buffer, alloc);
+
+		buffer = VK_NULL_HANDLE;
+		tracked.clear();
+	}
+
+	bool BufferArena::Allocate(VkDeviceSize size, VkDeviceSize &offset)
+	{
+		if (buffer == VK_NULL_HANDLE) {
+			VkBufferCreateInfo BufferCreateInfo = {};
+			BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			BufferCreateInfo.size = this->size * epochs;
+			BufferCreateInfo.usage = usage;
+			SetSharingMode(BufferCreateInfo, families);
+
+			VmaAllocationCreateInfo ArenaAllocInfo = LocalAllocation(mapped);
+
+			if (vmaCreateBuffer(allocator, &BufferCreateInfo, &ArenaAllocInfo, &buffer, &alloc, nullptr) != VK_SUCCESS) {
+				buffer = VK_NULL_HANDLE;
+				throw vkcl::util::Exception("Failed to create transient arena");
+			}
+		}
+
+		VkDeviceSize reserved = (size + alignment - 1) & ~(alignment - 1);
+		if (reserved > this->size - used)
+			return false;
+
+		offset = current * this->size + used;
+		used += reserved;
+
+		return true;
+	}
+
+	void BufferArena::Track(util::SlotHandle handle)
+	{
+		tracked[current].push_back(handle);
+	}
+
+	std::vector<util::SlotHandle> BufferArena::Tracked()
+	{
+		std::vector<util::SlotHandle> handles;
+		for (auto &region : tracked)
+			handles.insert(handles.end(), region.begin(), region.end());
+
+		return handles;
+	}
+
+	VkDeviceSize BufferArena::Release()
+	{
+		if (buffer == VK_NULL_HANDLE)
+			return 0;
+
+		vmaDestroyBuffer(allocator, buffer, alloc);
+		buffer = VK_NULL_HANDLE;
+		used = 0;
+		for (auto &region : tracked)
+			region.clear();
+
+		return size * epochs;
+	}
+
+	std::vector<util::SlotHandle> BufferArena::Advance()
+	{
+		current = (current + 1) % epochs;
+		used = 0;
+
+		std::vector<util::SlotHandle> expired;
+		expired.swap(tracked[current]);
+
+		return expired;
+	}
+
+}
@@ -0,0 +1,283 @@
+#include <vkcl/vk_reflect.h>
+
+#include <spirv/spirv.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+
+namespace vkcl {
+
+	struct SpvDecorations {
+		uint32_t set = UINT32_MAX;
+		uint32_t binding = UINT32_MAX;
+		uint32_t specid = UINT32_MAX;
+		uint32_t arraystride = 0;
+		uint32_t builtin = UINT32_MAX;
+		bool block = false;
+		bool bufferblock = false;
+		bool nonwritable = false;
+	};
+
+	struct SpvMemberDecorations {
+		uint32_t offset = 0;
+		uint32_t matrixstride = 0;
+		bool nonwritable = false;
+	};
+
+	struct SpvModule {
+		std::map<uint32_t, const uint32_t *> ids; // result id -> instruction
+		std::map<uint32_t, SpvDecorations> decorations;
+		std::map<std::pair<uint32_t, uint32_t>, SpvMemberDecorations> members;
+
+		inline uint32_t op(uint32_t id) const
+		{
+			auto it = ids.find(id);
+			return it == ids.end() ? (uint32_t)spv::OpNop : (it->second[0] & spv::OpCodeMask);
+		}
+
+		inline const uint32_t *get(uint32_t id) const
+		{
+			auto it = ids.find(id);
+			if (it == ids.end())
+				throw vkcl::util::Exception("SPIR-V references an undefined id");
+			return it->second;
+		}
+
+		// value of a scalar (spec) constant, spec constants give their default
+		uint32_t Constant(uint32_t id) const
+		{
+			uint32_t o = op(id);
+			if (o != spv::OpConstant && o != spv::OpSpecConstant)
+				throw vkcl::util::Exception("SPIR-V array length or workgroup size is not a scalar constant");
+			return get(id)[3];
+		}
+
+		uint32_t SizeOf(uint32_t type, uint32_t matrixstride = 0) const
+		{
+			const uint32_t *inst = get(type);
+			switch (inst[0] & spv::OpCodeMask) {
+			case spv::OpTypeBool:
+				return 4;
+			case spv::OpTypeInt:
+			case spv::OpTypeFloat:
+				return inst[2] / 8;
+			case spv::OpTypeVector:
+				return inst[3] * SizeOf(inst[2]);
+			case spv::OpTypeMatrix:
+				return inst[3] * (matrixstride ? matrixstride : SizeOf(inst[2]));
+			case spv::OpTypeArray: {
+				auto it = decorations.find(type);
+				uint32_t stride = (it != decorations.end() && it->second.arraystride) ? it->second.arraystride : SizeOf(inst[2]);
+				return Constant(inst[3]) * stride;
+			}
+			case spv::OpTypeStruct: {
+				uint32_t size = 0;
+				uint32_t count = (inst[0] >> spv::WordCountShift) - 2;
+				for (uint32_t i = 0; i < count; i++) {
+					auto it = members.find(std::make_pair(type, i));
+					SpvMemberDecorations member = it != members.end() ? it->second : SpvMemberDecorations();
+					size = std::max(size, member.offset + SizeOf(inst[2 + i], member.matrixstride));
+				}
+				return size;
+			}
+			case spv::OpTypePointer:
+				return inst[2] == spv::StorageClassPhysicalStorageBuffer ? 8 : 0; // buffer references are 64 bit addresses
+			default:
+				return 0; // runtime arrays and opaque types have no size
+			}
+		}
+	};
+
+	ShaderReflection ReflectShader(const uint32_t *code, size_t words)
+	{
+		if (words < 5 || code[0] != spv::MagicNumber) {
+			throw vkcl::util::Exception("Shader code is not a SPIR-V module");
+		}
+
+		SpvModule module;
+		std::vector<const uint32_t *> variables;
+		const uint32_t *localsize = nullptr;
+		bool localsizeid = false;
+		uint32_t entry = UINT32_MAX;
+
+		// everything needed lives in front of the first function
+		for (size_t i = 5; i < words;) {
+			const uint32_t *inst = code + i;
+			uint32_t op = inst[0] & spv::OpCodeMask;
+			uint32_t count = inst[0] >> spv::WordCountShift;
+
+			if (count == 0 || i + count > words) {
+				throw vkcl::util::Exception("Shader code is a truncated SPIR-V module");
+			}
+
+			if (op == spv::OpFunction)
+				break;
+
+			switch (op) {
+			case spv::OpEntryPoint:
+				if (inst[1] == spv::ExecutionModelGLCompute && std::strcmp((const char *)&inst[3], "main") == 0)
+					entry = inst[2];
+				break;
+			case spv::OpExecutionMode:
+			case spv::OpExecutionModeId:
+				if (inst[2] == spv::ExecutionModeLocalSize || inst[2] == spv::ExecutionModeLocalSizeId) {
+					if (entry == UINT32_MAX || inst[1] == entry) {
+						localsize = inst;
+						localsizeid = inst[2] == spv::ExecutionModeLocalSizeId;
+					}
+				}
+				break;
+			case spv::OpDecorate: {
+				SpvDecorations &dec = module.decorations[inst[1]];
+				switch (inst[2]) {
+				case spv::DecorationDescriptorSet: dec.set = inst[3]; break;
+				case spv::DecorationBinding: dec.binding = inst[3]; break;
+				case spv::DecorationSpecId: dec.specid = inst[3]; break;
+				case spv::DecorationArrayStride: dec.arraystride = inst[3]; break;
+				case spv::DecorationBuiltIn: dec.builtin = inst[3]; break;
+				case spv::DecorationBlock: dec.block = true; break;
+				case spv::DecorationBufferBlock: dec.bufferblock = true; break;
+				case spv::DecorationNonWritable: dec.nonwritable = true; break;
+				default: break;
+				}
+				break;
+			}
+			case spv::OpMemberDecorate: {
+				SpvMemberDecorations &dec = module.members[std::make_pair(inst[1], inst[2])];
+				switch (inst[3]) {
+				case spv::DecorationOffset: dec.offset = inst[4]; break;
+				case spv::DecorationMatrixStride: dec.matrixstride = inst[4]; break;
+				case spv::DecorationNonWritable: dec.nonwritable = true; break;
+				default: break;
+				}
+				break;
+			}
+			case spv::OpTypeVoid: case spv::OpTypeBool: case spv::OpTypeInt: case spv::OpTypeFloat:
+			case spv::OpTypeVector: case spv::OpTypeMatrix: case spv::OpTypeImage: case spv::OpTypeSampler:
+			case spv::OpTypeSampledImage: case spv::OpTypeArray: case spv::OpTypeRuntimeArray:
+			case spv::OpTypeStruct: case spv::OpTypePointer:
+				module.ids[inst[1]] = inst;
+				break;
+			case spv::OpConstant: case spv::OpSpecConstant:
+			case spv::OpConstantComposite: case spv::OpSpecConstantComposite:
+				module.ids[inst[2]] = inst;
+				break;
+			case spv::OpVariable:
+				module.ids[inst[2]] = inst;
+				variables.push_back(inst);
+				break;
+			default:
+				break;
+			}
+
+			i += count;
+		}
+
+		if (entry == UINT32_MAX) {
+			throw vkcl::util::Exception("SPIR-V module has no compute entry point called main");
+		}
+
+		ShaderReflection reflection = {};
+		for (int i = 0; i < 3; i++) {
+			reflection.LocalSize[i] = 1;
+			reflection.LocalSizeId[i] = UINT32_MAX;
+		}
+
+		// LocalSizeId and the WorkgroupSize builtin can both refer to specialization constants
+		auto SetLocalSize = [&](int i, uint32_t id) {
+			reflection.LocalSize[i] = module.Constant(id);
+			if (module.op(id) == spv::OpSpecConstant)
+				reflection.LocalSizeId[i] = module.decorations[id].specid;
+		};
+
+		if (localsize) {
+			for (int i = 0; i < 3; i++) {
+				if (localsizeid)
+					SetLocalSize(i, localsize[3 + i]);
+				else
+					reflection.LocalSize[i] = localsize[3 + i];
+			}
+		}
+
+		for (auto &dec : module.decorations) {
+			uint32_t op = module.op(dec.first);
+			if (dec.second.builtin == spv::BuiltInWorkgroupSize && (op == spv::OpConstantComposite || op == spv::OpSpecConstantComposite)) {
+				const uint32_t *inst = module.get(dec.first);
+				for (int i = 0; i < 3; i++)
+					SetLocalSize(i, inst[3 + i]);
+			}
+		}
+
+		for (auto variable : variables) {
+			uint32_t storage = variable[3];
+			const uint32_t *pointer = module.get(variable[1]);
+			uint32_t type = pointer[3];
+			SpvDecorations dec = module.decorations[variable[2]];
+
+			if (storage == spv::StorageClassPushConstant) {
+				reflection.PushConstantSize = std::max(reflection.PushConstantSize, module.SizeOf(type));
+				continue;
+			}
+
+			if (storage != spv::StorageClassUniform && storage != spv::StorageClassStorageBuffer && storage != spv::StorageClassUniformConstant)
+				continue;
+
+			ShaderBinding binding = {};
+			binding.set = dec.set == UINT32_MAX ? 0 : dec.set;
+			binding.binding = dec.binding == UINT32_MAX ? 0 : dec.binding;
+			binding.count = 1;
+			binding.readonly = dec.nonwritable;
+
+			// arrays of descriptors
+			while (module.op(type) == spv::OpTypeArray || module.op(type) == spv::OpTypeRuntimeArray) {
+				const uint32_t *inst = module.get(type);
+				binding.count = module.op(type) == spv::OpTypeArray ? binding.count * module.Constant(inst[3]) : 0;
+				type = inst[2];
+			}
+
+			const uint32_t *inst = module.get(type);
+			switch (inst[0] & spv::OpCodeMask) {
+			case spv::OpTypeStruct: {
+				SpvDecorations &typedec = module.decorations[type];
+				bool storagebuffer = storage == spv::StorageClassStorageBuffer || typedec.bufferblock;
+				binding.type = storagebuffer ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+				// a block is read only when all of its members are
+				uint32_t members = (inst[0] >> spv::WordCountShift) - 2;
+				bool nonwritable = members > 0;
+				for (uint32_t i = 0; i < members; i++)
+					nonwritable = nonwritable && module.members[std::make_pair(type, i)].nonwritable;
+
+				binding.readonly = binding.readonly || nonwritable || !storagebuffer;
+				break;
+			}
+			case spv::OpTypeImage:
+				// operand 7 is Sampled, 2 means it is used without a sampler
+				if (inst[3] == spv::DimBuffer)
+					binding.type = inst[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				else
+					binding.type = inst[7] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				break;
+			case spv::OpTypeSampler:
+				binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+				break;
+			case spv::OpTypeSampledImage:
+				binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				break;
+			default:
+				continue;
+			}
+
+			reflection.bindings.push_back(binding);
+		}
+
+		std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ShaderBinding &a, const ShaderBinding &b) {
+			return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+
+		return reflection;
+	}
+
+}
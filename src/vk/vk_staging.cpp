@@ -0,0 +1,157 @@
+#include <vkcl/vk_staging.h>
+
+#include <cstring>
+
+namespace vkcl {
+
+	void StagingRing::Load(VkDevice device, VmaAllocator allocator, FencePool *fences, VkCommandPool pool, uint32_t *families, VkDeviceSize size)
+	{
+		this->device = device;
+		this->allocator = allocator;
+		this->fences = fences;
+		this->pool = pool;
+		this->size = (size + StagingAlignment - 1) & ~(StagingAlignment - 1);
+		if (this->size < 2 * StagingAlignment)
+			this->size = 2 * StagingAlignment;
+		this->head = 0;
+		this->tail = 0;
+
+		VkBufferCreateInfo BufferCreateInfo = {};
+		BufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		BufferCreateInfo.size = this->size;
+		BufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		SetSharingMode(BufferCreateInfo, families);
+
+		VmaAllocationCreateInfo RingAllocInfo = {};
+		RingAllocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+		RingAllocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+		if (vmaCreateBuffer(allocator, &BufferCreateInfo, &RingAllocInfo, &buffer, &alloc, &allocinfo) != VK_SUCCESS) {
+			throw vkcl::util::Exception("Failed to create staging buffer");
+		}
+	}
+
+	void StagingRing::Delete()
+	{
+		Flush();
+
+		if (!commandbuffers.empty())
+			vkFreeCommandBuffers(device, pool, commandbuffers.size(), commandbuffers.data());
+		commandbuffers.clear();
+
+		vmaDestroyBuffer(allocator, buffer, alloc);
+	}
+
+	StagingSpan &StagingRing::Acquire(VkDeviceSize size)
+	{
+		VkDeviceSize reserved = (size + StagingAlignment - 1) & ~(StagingAlignment - 1);
+		if (reserved > this->size) {
+			throw vkcl::util::Exception("Staging request is larger than the staging ring");
+		}
+
+		VkDeviceSize start;
+		for (;;) {
+			if (spans.empty())
+				head = tail = 0;
+
+			// a span never wraps around, skip to the start of the buffer instead
+			start = head;
+			if ((start % this->size) + reserved > this->size)
+				start += this->size - (start % this->size);
+
+			if (start + reserved - tail <= this->size)
+				break;
+
+			RetireFront();
+		}
+
+		StagingSpan span = {};
+		if (commandbuffers.empty()) {
+			VkCommandBufferAllocateInfo cmdbufinfo = {};
+			cmdbufinfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			cmdbufinfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			cmdbufinfo.commandPool = pool;
+			cmdbufinfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device, &cmdbufinfo, &span.commandbuffer) != VK_SUCCESS) {
+				throw vkcl::util::Exception("Failed to allocate command buffer for transfer operation");
+			}
+		} else {
+			span.commandbuffer = commandbuffers.back();
+			commandbuffers.pop_back();
+		}
+
+		span.id = nextid++;
+		span.offset = start % this->size;
+		span.size = size;
+		span.end = start + reserved;
+		span.mapped = (char *)allocinfo.pMappedData + span.offset;
+		span.readback = nullptr;
+		span.submitted = false;
+
+		span.submission = fences->Acquire(span.fence);
+
+		head = span.end;
+		spans.push_back(span);
+
+		return spans.back();
+	}
+
+	void StagingRing::RetireFront()
+	{
+		StagingSpan &span = spans.front();
+
+		if (span.submitted) {
+			fences->Wait(span.submission);
+
+			if (span.readback)
+				std::memcpy(span.readback, span.mapped, span.size);
+		} else {
+			// never submitted, hand the fence back without waiting on it
+			fences->Release(span.submission);
+		}
+
+		commandbuffers.push_back(span.commandbuffer);
+		tail = span.end;
+		spans.pop_front();
+	}
+
+	void StagingRing::Retire(uint64_t id)
+	{
+		while (!spans.empty() && spans.front().id <= id)
+			RetireFront();
+	}
+
+	bool StagingRing::Poll(uint64_t id)
+	{
+		// fences signal in submission order, so the newest span up to id decides for all of them
+		for (auto it = spans.rbegin(); it != spans.rend(); it++) {
+			if (it->id > id)
+				continue;
+
+			if (!fences->Poll(it->submission))
+				return false;
+
+			break;
+		}
+
+		Retire(id);
+		return true;
+	}
+
+	void StagingRing::Flush()
+	{
+		while (!spans.empty())
+			RetireFront();
+	}
+
+	VkDeviceSize StagingRing::Chunk(VkDeviceSize size)
+	{
+		if (size <= this->size)
+			return size;
+
+		// keep two chunks in flight so filling one overlaps with copying the other
+		return (this->size / 2) & ~(StagingAlignment - 1);
+	}
+
+}
@@ -0,0 +1,191 @@
+#include <vkcl/vk_sync.h>
+
+#include <algorithm>
+
+namespace vkcl {
+
+	void FencePool::Load(VkDevice device)
+	{
+		this->device = device;
+	}
+
+	void FencePool::Delete()
+	{
+		Flush();
+
+		for (auto &slot : slots)
+			vkDestroyFence(device, slot.fence, nullptr);
+
+		slots.clear();
+		idle.clear();
+	}
+
+	Submission FencePool::Acquire(VkFence &fence)
+	{
+		while (!pending.empty() && !Pending(pending.front()))
+			pending.pop_front();
+
+		if (idle.empty())
+			Reclaim();
+
+		uint32_t index;
+		if (idle.empty()) {
+			Slot slot = {};
+
+			VkFenceCreateInfo fenceinfo = {};
+			fenceinfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			fenceinfo.flags = 0;
+
+			if (vkCreateFence(device, &fenceinfo, nullptr, &slot.fence) != VK_SUCCESS) {
+				throw vkcl::util::Exception("Failed to create fence");
+			}
+
+			index = slots.size();
+			slots.push_back(slot);
+		} else {
+			index = idle.back();
+			idle.pop_back();
+		}
+
+		slots[index].busy = true;
+		fence = slots[index].fence;
+
+		Submission submission = { index, slots[index].serial };
+		pending.push_back(submission);
+
+		return submission;
+	}
+
+	bool FencePool::Pending(Submission submission)
+	{
+		return submission.slot < slots.size() && slots[submission.slot].busy && slots[submission.slot].serial == submission.serial;
+	}
+
+	void FencePool::Recycle(uint32_t slot)
+	{
+		vkResetFences(device, 1, &slots[slot].fence);
+		slots[slot].serial++;
+		slots[slot].busy = false;
+		idle.push_back(slot);
+	}
+
+	void FencePool::Wait(Submission submission)
+	{
+		// a handle whose slot has moved on has already completed
+		if (!Pending(submission))
+			return;
+
+		vkWaitForFences(device, 1, &slots[submission.slot].fence, VK_TRUE, UINT64_MAX);
+		Recycle(submission.slot);
+	}
+
+	bool FencePool::Poll(Submission submission)
+	{
+		if (!Pending(submission))
+			return true;
+
+		if (vkGetFenceStatus(device, slots[submission.slot].fence) != VK_SUCCESS)
+			return false;
+
+		Recycle(submission.slot);
+		return true;
+	}
+
+	void FencePool::Release(Submission submission)
+	{
+		if (Pending(submission))
+			Recycle(submission.slot);
+	}
+
+	void FencePool::Track(SubmissionList &list, Submission submission)
+	{
+		Poll(list);
+		list.push_back(submission);
+	}
+
+	void FencePool::Wait(SubmissionList &list)
+	{
+		for (auto &submission : list)
+			Wait(submission);
+
+		list.clear();
+	}
+
+	bool FencePool::Poll(SubmissionList &list)
+	{
+		list.erase(std::remove_if(list.begin(), list.end(), [this](Submission submission) { return Poll(submission); }), list.end());
+		return list.empty();
+	}
+
+	void FencePool::Reclaim()
+	{
+		// Handles nobody waited on are recycled once their fence has signalled
+		for (auto it = pending.begin(); it != pending.end();) {
+			if (!Pending(*it) || Poll(*it))
+				it = pending.erase(it);
+			else
+				it++;
+		}
+	}
+
+	void FencePool::Flush()
+	{
+		for (auto &submission : pending)
+			Wait(submission);
+
+		pending.clear();
+	}
+
+	void BarrierBatch::Access(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, AccessState &state, VkPipelineStageFlags stage, VkAccessFlags access)
+	{
+		const VkAccessFlags writes = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		VkAccessFlags reads = access & ~writes;
+
+		// Reads need the last write made visible to them unless an earlier barrier already did so.
+		// A write needs it as well when there were no readers in between to chain through.
+		if (state.writeaccess && ((reads & ~state.visible) || ((access & writes) && !state.readstages))) {
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = state.writeaccess;
+			barrier.dstAccessMask = access;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = buffer;
+			barrier.offset = offset;
+			barrier.size = size;
+			barriers.push_back(barrier);
+
+			srcstage |= state.writestage;
+			dststage |= stage;
+			state.visible |= reads;
+		}
+
+		if (access & writes) {
+			// write after read only has to wait for the readers to finish
+			if (state.readstages) {
+				srcstage |= state.readstages;
+				dststage |= stage;
+			}
+
+			state.writestage = stage;
+			state.writeaccess = access & writes;
+			state.readstages = 0;
+			state.visible = 0;
+		} else {
+			state.readstages |= stage;
+		}
+	}
+
+	void BarrierBatch::Record(VkCommandBuffer commandbuffer)
+	{
+		if (empty())
+			return;
+
+		vkCmdPipelineBarrier(commandbuffer, srcstage, dststage, 0, 0, nullptr, barriers.size(), barriers.data(), 0, nullptr);
+
+		srcstage = 0;
+		dststage = 0;
+		barriers.clear();
+	}
+
+}
\ No newline at end of file
@@ -1,120 +1,1534 @@
-#include <vkcl/vkcl.h>
-
-#include <cstdio>
-#include <string>
-#include <iostream>
-#include <vector>
-
-#include <cstdlib>
-
-int main()
-{
-	std::vector<vkcl::Device> devices = vkcl::QueryAllDevices();
-
-	std::cout << "Detected Devices:" << std::endl;
-	for (size_t i = 0; i < devices.size(); i++) {
-		printf("\t%s - GPU ID %d\n", devices[i].getName().c_str(), devices[i].getId());
-	}
-	std::cout << std::endl;
-
-	for (size_t gpu = 0; gpu < devices.size(); gpu++) {
-		{
-			std::cout << "Device Memory Test on GPU ID " << gpu << std::endl;
-
-			// test parameters
-			const int BUFFER_COUNT = 4;
-			const int TEST_SIZE = 0xFFFF;
-			const int TEST_RES = 0xDEADBEEF;
-
-			int *testdata = new int[TEST_SIZE];
-			
-			for (int i = 0; i < TEST_SIZE; i++)
-				testdata[i] = TEST_RES;
-
-			vkcl::Buffer *buffers[BUFFER_COUNT];
-			for (int i = 0; i < BUFFER_COUNT; i++) {
-				buffers[i] = devices[gpu].CreateBuffer(sizeof(int) * TEST_SIZE);
-				devices[gpu].UploadData(buffers[i], testdata);
-			}
-
-			delete testdata;
-
-			for (int i = 0; i < BUFFER_COUNT; i++) {
-				std::cout << "Buffer " << i << " integrity: " << std::flush;
-				testdata = (int *)devices[gpu].DownloadData(buffers[i]);
-
-				for (int i = 0; i < TEST_SIZE; i++) {
-					if (testdata[i] != (signed)TEST_RES) {
-						std::cout << "Failed\n" << std::flush;
-						return -1;
-					}
-				}
-				
-				std::cout << "Validated" << std::endl;
-				devices[gpu].ReleaseData(testdata);
-			}
-
-			
-			// Clean up after ourselves now
-			for (int i = 0; i < BUFFER_COUNT; i++)
-				devices[gpu].DeleteBuffer(buffers[i]);
-
-			std::cout << "Success\n";
-		}
-
-		{
-			// Compute Example
-
-			std::cout << "Compute Shader Test\n";
-
-			const int BUFFER_COUNT = 3;
-			const int TEST_SIZE = 0x11;
-			
-			vkcl::Shader *shader;
-			vkcl::Buffer *buffers[BUFFER_COUNT];
-
-			float *testdata = new float[TEST_SIZE];
-
-			for (int i = 0; i < BUFFER_COUNT; i++) {
-				buffers[i] = devices[gpu].CreateBuffer(sizeof(int) * TEST_SIZE);
-				devices[gpu].UploadData(buffers[i], testdata);
-			}
-
-			try {
-				shader = devices[gpu].CreateShader("./test/test_mul.spv", BUFFER_COUNT);
-				devices[gpu].BindBuffers(shader, buffers);
-				devices[gpu].RunShader(shader, TEST_SIZE, 1, 1);
-			} catch (vkcl::util::Exception &e) {
-				std::cout << e.getMsg() << std::endl;
-				return -1;
-			}
-
-			for (int i = 1; i < BUFFER_COUNT; i++) {
-				std::cout << "Buffer " << i << " contents: ";
-
-				testdata = (float *)devices[gpu].DownloadData(buffers[i]);
-
-				for (int i = 0; i < TEST_SIZE; i++) {
-					std::cout << testdata[i] << " ";
-				}
-				
-				std::cout << std::endl;
-				devices[gpu].ReleaseData(testdata);
-			}
-
-			std::cout << "Success\n";
-
-			for (int i = 0; i < BUFFER_COUNT; i++)
-				devices[gpu].DeleteBuffer(buffers[i]);
-
-			devices[gpu].DeleteShader(shader);
-		}
-	}
-
-	printf("Shutting down..\n");
-	for (auto dev : devices) {
-		dev.Delete();
-	}
-
-	return 0;
-}
+#include <vkcl/vkcl.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+
+int main()
+{
+	std::vector<vkcl::Device> devices = vkcl::QueryAllDevices();
+
+	std::cout << "Detected Devices:" << std::endl;
+	for (size_t i = 0; i < devices.size(); i++) {
+		printf("\t%s - GPU ID %d\n", devices[i].getName().c_str(), devices[i].getId());
+	}
+	std::cout << std::endl;
+
+	for (size_t gpu = 0; gpu < devices.size(); gpu++) {
+		{
+			std::cout << "Device Memory Test on GPU ID " << gpu << std::endl;
+
+			// test parameters
+			const int BUFFER_COUNT = 4;
+			const int TEST_SIZE = 0xFFFF;
+			const int TEST_RES = 0xDEADBEEF;
+
+			int *testdata = new int[TEST_SIZE];
+			
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = TEST_RES;
+
+			vkcl::Buffer *buffers[BUFFER_COUNT];
+			for (int i = 0; i < BUFFER_COUNT; i++) {
+				buffers[i] = devices[gpu].CreateBuffer(sizeof(int) * TEST_SIZE);
+				devices[gpu].UploadData(buffers[i], testdata);
+			}
+
+			delete testdata;
+
+			for (int i = 0; i < BUFFER_COUNT; i++) {
+				std::cout << "Buffer " << i << " integrity: " << std::flush;
+				testdata = (int *)devices[gpu].DownloadData(buffers[i]);
+
+				for (int i = 0; i < TEST_SIZE; i++) {
+					if (testdata[i] != (signed)TEST_RES) {
+						std::cout << "Failed\n" << std::flush;
+						return -1;
+					}
+				}
+				
+				std::cout << "Validated" << std::endl;
+				devices[gpu].ReleaseData(testdata);
+			}
+
+			
+			// Clean up after ourselves now
+			for (int i = 0; i < BUFFER_COUNT; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Staging Ring Test on GPU ID " << gpu << std::endl;
+
+			// a transfer several times larger than the ring has to be split into chunks
+			const int TEST_SIZE = 0x40000;
+
+			int *testdata = new int[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = i;
+
+			devices[gpu].SetStagingSize(0x10000);
+
+			vkcl::Buffer *buffer = devices[gpu].CreateBuffer(sizeof(int) * TEST_SIZE);
+			devices[gpu].UploadData(buffer, testdata);
+
+			delete[] testdata;
+
+			std::cout << "Chunked buffer integrity: " << std::flush;
+			testdata = (int *)devices[gpu].DownloadData(buffer);
+
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (testdata[i] != i) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+
+			std::cout << "Validated" << std::endl;
+			devices[gpu].ReleaseData(testdata);
+			devices[gpu].DeleteBuffer(buffer);
+
+			devices[gpu].SetStagingSize(vkcl::StagingDefaultSize);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Async Transfer Test on GPU ID " << gpu << std::endl;
+
+			const int BUFFER_COUNT = 4;
+			const int TEST_SIZE = 0xFFFF;
+
+			int *testdata = new int[TEST_SIZE];
+			int *results[BUFFER_COUNT];
+			vkcl::Buffer *buffers[BUFFER_COUNT];
+			vkcl::Transfer transfers[BUFFER_COUNT];
+
+			// the host buffer is refilled while the previous uploads are still in flight
+			for (int i = 0; i < BUFFER_COUNT; i++) {
+				for (int j = 0; j < TEST_SIZE; j++)
+					testdata[j] = i * TEST_SIZE + j;
+
+				buffers[i] = devices[gpu].CreateBuffer(sizeof(int) * TEST_SIZE);
+				transfers[i] = devices[gpu].UploadDataAsync(buffers[i], testdata);
+			}
+
+			delete[] testdata;
+
+			for (int i = 0; i < BUFFER_COUNT; i++) {
+				results[i] = new int[TEST_SIZE];
+				transfers[i] = devices[gpu].DownloadDataAsync(buffers[i], results[i]);
+			}
+
+			while (!devices[gpu].Poll(transfers[BUFFER_COUNT - 1]))
+				;
+
+			for (int i = 0; i < BUFFER_COUNT; i++) {
+				std::cout << "Buffer " << i << " integrity: " << std::flush;
+				devices[gpu].Wait(transfers[i]);
+
+				for (int j = 0; j < TEST_SIZE; j++) {
+					if (results[i][j] != i * TEST_SIZE + j) {
+						std::cout << "Failed\n" << std::flush;
+						return -1;
+					}
+				}
+
+				std::cout << "Validated" << std::endl;
+				delete[] results[i];
+				devices[gpu].DeleteBuffer(buffers[i]);
+			}
+
+			std::cout << "Success\n";
+		}
+
+		{
+			// Compute Example
+
+			std::cout << "Compute Shader Test\n";
+
+			const int BUFFER_COUNT = 3;
+			const int TEST_SIZE = 0x11;
+			
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[BUFFER_COUNT];
+
+			float *testdata = new float[TEST_SIZE];
+
+			for (int i = 0; i < BUFFER_COUNT; i++) {
+				buffers[i] = devices[gpu].CreateBuffer(sizeof(int) * TEST_SIZE);
+				devices[gpu].UploadData(buffers[i], testdata);
+			}
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_mul.spv", BUFFER_COUNT);
+				devices[gpu].BindBuffers(shader, buffers);
+				devices[gpu].RunShader(shader, TEST_SIZE, 1, 1);
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			for (int i = 1; i < BUFFER_COUNT; i++) {
+				std::cout << "Buffer " << i << " contents: ";
+
+				testdata = (float *)devices[gpu].DownloadData(buffers[i]);
+
+				for (int i = 0; i < TEST_SIZE; i++) {
+					std::cout << testdata[i] << " ";
+				}
+				
+				std::cout << std::endl;
+				devices[gpu].ReleaseData(testdata);
+			}
+
+			std::cout << "Success\n";
+
+			for (int i = 0; i < BUFFER_COUNT; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+
+			devices[gpu].DeleteShader(shader);
+		}
+
+		{
+			std::cout << "Async Compute Test\n";
+
+			const int SHADER_COUNT = 2;
+			const int BUFFER_COUNT = 3;
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shaders[SHADER_COUNT];
+			vkcl::Buffer *buffers[SHADER_COUNT][BUFFER_COUNT];
+			vkcl::Submission submissions[SHADER_COUNT];
+
+			try {
+				// both dispatches are in flight at the same time
+				for (int i = 0; i < SHADER_COUNT; i++) {
+					for (int j = 0; j < BUFFER_COUNT; j++)
+						buffers[i][j] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+					shaders[i] = devices[gpu].CreateShader("./test/test_mul.spv", BUFFER_COUNT);
+					devices[gpu].BindBuffers(shaders[i], buffers[i]);
+					devices[gpu].Submit(shaders[i], TEST_SIZE, 1, 1);
+
+					// unchanged dispatches replay the recorded command buffer
+					submissions[i] = devices[gpu].Submit(shaders[i], TEST_SIZE, 1, 1);
+				}
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			for (int i = 0; i < SHADER_COUNT; i++) {
+				std::cout << "Shader " << i << " results: " << std::flush;
+				devices[gpu].Wait(submissions[i]);
+
+				float *testdata = (float *)devices[gpu].DownloadData(buffers[i][1]);
+				for (int j = 0; j < TEST_SIZE; j++) {
+					if (testdata[j] != (float)(1 << j)) {
+						std::cout << "Failed\n" << std::flush;
+						return -1;
+					}
+				}
+
+				std::cout << "Validated" << std::endl;
+				devices[gpu].ReleaseData(testdata);
+
+				for (int j = 0; j < BUFFER_COUNT; j++)
+					devices[gpu].DeleteBuffer(buffers[i][j]);
+				devices[gpu].DeleteShader(shaders[i]);
+			}
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Command List Test\n";
+
+			const int BUFFER_COUNT = 3;
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[BUFFER_COUNT];
+			vkcl::CommandList *list;
+
+			float *testdata = new float[TEST_SIZE];
+			float *results = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = -1.0f;
+
+			for (int i = 0; i < BUFFER_COUNT; i++)
+				buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_mul.spv", BUFFER_COUNT);
+				devices[gpu].BindBuffers(shader, buffers);
+
+				// upload, dispatch and download end up in a single submission
+				list = devices[gpu].CreateCommandList();
+				for (int i = 0; i < BUFFER_COUNT; i++)
+					devices[gpu].RecordUpload(list, buffers[i], testdata);
+				devices[gpu].RecordDispatch(list, shader, TEST_SIZE, 1, 1);
+				devices[gpu].RecordDownload(list, buffers[2], results);
+				devices[gpu].Submit(list);
+				devices[gpu].Wait(list);
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Buffer 2 results: " << std::flush;
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != (float)(1 << i)) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+
+			delete[] testdata;
+			delete[] results;
+
+			devices[gpu].DeleteCommandList(list);
+			for (int i = 0; i < BUFFER_COUNT; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Push Constant Test\n";
+
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[2];
+
+			float *testdata = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = (float)i;
+
+			for (int i = 0; i < 2; i++)
+				buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+			// out = in * alpha + beta, swept over alpha without touching the buffers
+			for (int sweep = 1; sweep <= 3; sweep++) {
+				float params[2] = { (float)sweep, 1.0f };
+
+				try {
+					if (sweep == 1) {
+						devices[gpu].UploadData(buffers[0], testdata);
+						shader = devices[gpu].CreateShader("./test/test_scale.spv", 2, sizeof(params));
+						devices[gpu].BindBuffers(shader, buffers);
+					}
+
+					devices[gpu].RunShader(shader, TEST_SIZE, 1, 1, params);
+				} catch (vkcl::util::Exception &e) {
+					std::cout << e.getMsg() << std::endl;
+					return -1;
+				}
+
+				std::cout << "Alpha " << sweep << " results: " << std::flush;
+				float *results = (float *)devices[gpu].DownloadData(buffers[1]);
+				for (int i = 0; i < TEST_SIZE; i++) {
+					if (results[i] != testdata[i] * params[0] + params[1]) {
+						std::cout << "Failed\n" << std::flush;
+						return -1;
+					}
+				}
+				std::cout << "Validated" << std::endl;
+				devices[gpu].ReleaseData(results);
+			}
+
+			delete[] testdata;
+			for (int i = 0; i < 2; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Reflection Test\n";
+
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[2];
+			float params[2] = { 2.0f, 0.5f };
+
+			float *testdata = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = (float)i;
+
+			for (int i = 0; i < 2; i++)
+				buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+			try {
+				// bindings, push constants and workgroup size all come from the module
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				if (shader->BufferCount != 2 || shader->PushConstantSize != sizeof(params) || !shader->bindings[0].readonly || shader->bindings[1].readonly || shader->LocalSize[0] != 1) {
+					std::cout << "Failed\n";
+					return -1;
+				}
+
+				devices[gpu].UploadData(buffers[0], testdata);
+				devices[gpu].BindBuffers(shader, buffers);
+				devices[gpu].RunShader(shader, TEST_SIZE, 1, 1, params);
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Buffer 1 results: " << std::flush;
+			float *results = (float *)devices[gpu].DownloadData(buffers[1]);
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != testdata[i] * params[0] + params[1]) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+			devices[gpu].ReleaseData(results);
+
+			// test_mul.spv uses three bindings
+			try {
+				devices[gpu].CreateShader("./test/test_mul.spv", 2);
+				std::cout << "Failed\n";
+				return -1;
+			} catch (vkcl::util::Exception &e) {
+				std::cout << "Rejected: " << e.getMsg() << std::endl;
+			}
+
+			delete[] testdata;
+			for (int i = 0; i < 2; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Element Dispatch Test\n";
+
+			// one group more than a single dispatch can hold, plus a partial group
+			const uint32_t TEST_SIZE = 64 * 65536 + 17;
+
+			struct {
+				float alpha;
+				uint32_t count;
+			} params = { 2.0f, TEST_SIZE };
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[2];
+
+			float *x = new float[TEST_SIZE];
+			float *y = new float[TEST_SIZE];
+			for (uint32_t i = 0; i < TEST_SIZE; i++) {
+				x[i] = (float)(i % 1000);
+				y[i] = 1.0f;
+			}
+
+			for (int i = 0; i < 2; i++)
+				buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_saxpy.spv");
+				devices[gpu].UploadData(buffers[0], x);
+				devices[gpu].UploadData(buffers[1], y);
+				devices[gpu].BindBuffers(shader, buffers);
+				devices[gpu].Wait(devices[gpu].Dispatch1D(shader, TEST_SIZE, &params));
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Buffer 1 results: " << std::flush;
+			float *results = (float *)devices[gpu].DownloadData(buffers[1]);
+			for (uint32_t i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != 2.0f * x[i] + 1.0f) {
+					std::cout << "Failed at " << i << "\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+			devices[gpu].ReleaseData(results);
+
+			delete[] x;
+			delete[] y;
+			for (int i = 0; i < 2; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Concurrent Binding Test\n";
+
+			const int SET_COUNT = 100;
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *inputs;
+			vkcl::Buffer *outputs[SET_COUNT];
+			vkcl::Submission submissions[SET_COUNT];
+			float params[SET_COUNT][2];
+
+			float *testdata = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = (float)i;
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				inputs = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+				devices[gpu].UploadData(inputs, testdata);
+
+				// every dispatch of the one shader writes its own output and stays in flight while the next one is bound
+				for (int i = 0; i < SET_COUNT; i++) {
+					outputs[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+					params[i][0] = (float)i;
+					params[i][1] = 1.0f;
+
+					vkcl::Buffer *buffers[2] = { inputs, outputs[i] };
+					devices[gpu].BindBuffers(shader, buffers);
+					submissions[i] = devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params[i]);
+				}
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			for (int i = 0; i < SET_COUNT; i++) {
+				devices[gpu].Wait(submissions[i]);
+
+				float *results = (float *)devices[gpu].DownloadData(outputs[i]);
+				for (int j = 0; j < TEST_SIZE; j++) {
+					if (results[j] != testdata[j] * params[i][0] + params[i][1]) {
+						std::cout << "Output " << i << " Failed\n" << std::flush;
+						return -1;
+					}
+				}
+				devices[gpu].ReleaseData(results);
+				devices[gpu].DeleteBuffer(outputs[i]);
+			}
+			std::cout << "Validated " << SET_COUNT << " outputs" << std::endl;
+
+			delete[] testdata;
+			devices[gpu].DeleteBuffer(inputs);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Descriptor Cache Test\n";
+
+			const int STEPS = 8;
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[2];
+			vkcl::DescriptorEntry *sets[2];
+			float params[2] = { 2.0f, 0.0f };
+
+			float *testdata = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = 1.0f;
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				for (int i = 0; i < 2; i++)
+					buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+				devices[gpu].UploadData(buffers[0], testdata);
+
+				// ping-pong between the two buffers, each direction reuses the set written on its first bind
+				for (int step = 0; step < STEPS; step++) {
+					vkcl::Buffer *pingpong[2] = { buffers[step % 2], buffers[(step + 1) % 2] };
+					devices[gpu].BindBuffers(shader, pingpong);
+
+					// with push descriptors there are no sets to cache
+					if (shader->variant->push) {
+						;
+					} else if (step < 2) {
+						sets[step] = shader->set;
+					} else if (shader->set != sets[step % 2]) {
+						std::cout << "Failed\n";
+						return -1;
+					}
+
+					devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params);
+				}
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Buffer 0 results: " << std::flush;
+			float *results = (float *)devices[gpu].DownloadData(buffers[0]);
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != (float)(1 << STEPS)) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+			devices[gpu].ReleaseData(results);
+
+			delete[] testdata;
+			for (int i = 0; i < 2; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Descriptor Update Test\n";
+
+			const int BUFFER_COUNT = 5;
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[BUFFER_COUNT];
+			vkcl::CommandList *list;
+			float params[2] = { 2.0f, 0.0f };
+
+			float *testdata = new float[TEST_SIZE];
+			float *results = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = 1.0f;
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				for (int i = 0; i < BUFFER_COUNT; i++)
+					buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+				// every recorded dispatch keeps the buffers bound when it was recorded, whether
+				// they were written through an update template or pushed into the list
+				list = devices[gpu].CreateCommandList();
+				devices[gpu].RecordUpload(list, buffers[0], testdata);
+				for (int i = 0; i < BUFFER_COUNT - 1; i++) {
+					devices[gpu].BindBuffers(shader, &buffers[i]);
+					devices[gpu].RecordDispatch(list, shader, TEST_SIZE, 1, 1, params);
+				}
+				devices[gpu].RecordDownload(list, buffers[BUFFER_COUNT - 1], results);
+				devices[gpu].Submit(list);
+				devices[gpu].Wait(list);
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Buffer " << BUFFER_COUNT - 1 << " results: " << std::flush;
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != (float)(1 << (BUFFER_COUNT - 1))) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+
+			delete[] testdata;
+			delete[] results;
+
+			devices[gpu].DeleteCommandList(list);
+			for (int i = 0; i < BUFFER_COUNT; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Buffer Pool Test\n";
+
+			const int BUFFER_COUNT = 256;
+			const int ROUNDS = 2;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[BUFFER_COUNT];
+			float params[2] = { 2.0f, 1.0f };
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+
+				// the second round reuses the ranges freed by the first
+				for (int round = 0; round < ROUNDS; round++) {
+					for (int i = 0; i < BUFFER_COUNT; i++) {
+						int count = 1 + (i * 7 + round) % 0x40;
+						std::vector<float> data(count, (float)i);
+
+						buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * count);
+						devices[gpu].UploadData(buffers[i], data.data());
+					}
+
+					if (buffers[0]->devbuffer != buffers[1]->devbuffer) {
+						std::cout << "Small buffers were not pooled\n";
+						return -1;
+					}
+
+					// each pair scales its first buffer into its second, neighbouring ranges must be left alone
+					for (int i = 0; i < BUFFER_COUNT; i += 2) {
+						int count = 1 + (i * 7 + round) % 0x40;
+						int next = 1 + ((i + 1) * 7 + round) % 0x40;
+
+						devices[gpu].BindBuffers(shader, &buffers[i]);
+						devices[gpu].Submit(shader, std::min(count, next), 1, 1, params);
+					}
+
+					for (int i = 0; i < BUFFER_COUNT; i++) {
+						int count = 1 + (i * 7 + round) % 0x40;
+						int prev = 1 + ((i - 1) * 7 + round) % 0x40;
+
+						float *results = (float *)devices[gpu].DownloadData(buffers[i]);
+						for (int j = 0; j < count; j++) {
+							float expected = (i % 2 && j < prev) ? (i - 1) * 2.0f + 1.0f : (float)i;
+							if (results[j] != expected) {
+								std::cout << "Failed\n" << std::flush;
+								return -1;
+							}
+						}
+						devices[gpu].ReleaseData(results);
+					}
+
+					for (int i = 0; i < BUFFER_COUNT; i++)
+						devices[gpu].DeleteBuffer(buffers[i]);
+				}
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Validated " << BUFFER_COUNT * ROUNDS << " buffers" << std::endl;
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Buffer Handle Test\n";
+
+			const int BUFFER_COUNT = 4096;
+
+			std::vector<vkcl::Buffer *> buffers(BUFFER_COUNT);
+			std::vector<vkcl::util::SlotHandle> handles(BUFFER_COUNT);
+
+			try {
+				for (int i = 0; i < BUFFER_COUNT; i++) {
+					buffers[i] = devices[gpu].CreateBuffer(sizeof(float));
+					handles[i] = buffers[i]->handle;
+				}
+
+				for (int i = 0; i < BUFFER_COUNT; i += 2)
+					devices[gpu].DeleteBuffer(buffers[i]);
+
+				// the freed slots are reused, the old handles must not resolve to the new buffers
+				for (int i = 0; i < BUFFER_COUNT; i += 2)
+					buffers[i] = devices[gpu].CreateBuffer(sizeof(float));
+
+				for (int i = 0; i < BUFFER_COUNT; i++) {
+					vkcl::Buffer *found = devices[gpu].GetBuffer(handles[i]);
+					if ((i % 2 == 0 && found != nullptr) || (i % 2 == 1 && found != buffers[i])) {
+						std::cout << "Failed\n";
+						return -1;
+					}
+				}
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			for (int i = 0; i < BUFFER_COUNT; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+
+			bool rejected = false;
+			try {
+				devices[gpu].DeleteBuffer(buffers[0]);
+			} catch (vkcl::util::Exception &e) {
+				std::cout << "Rejected: " << e.getMsg() << std::endl;
+				rejected = true;
+			}
+
+			if (!rejected) {
+				std::cout << "Failed\n";
+				return -1;
+			}
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Transient Arena Test\n";
+
+			const int EPOCHS = 6;
+			const int TEST_SIZE = 0x11;
+			const int FALLBACK_SIZE = 2048; // more than a region holds
+
+			vkcl::Shader *shader;
+			vkcl::util::SlotHandle handles[EPOCHS];
+			float params[2] = { 2.0f, 0.0f };
+
+			float *testdata = new float[TEST_SIZE];
+			float *results = new float[FALLBACK_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = 1.0f;
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+
+				// small regions, so every epoch's last buffer falls back to a regular one
+				devices[gpu].SetTransientSize(4096, 2);
+
+				for (int epoch = 0; epoch < EPOCHS; epoch++) {
+					vkcl::Buffer *buffers[3];
+					for (int i = 0; i < 2; i++)
+						buffers[i] = devices[gpu].CreateTransientBuffer(sizeof(float) * TEST_SIZE);
+					buffers[2] = devices[gpu].CreateTransientBuffer(sizeof(float) * FALLBACK_SIZE);
+					handles[epoch] = buffers[0]->handle;
+
+					devices[gpu].UploadData(buffers[0], testdata);
+					for (int i = 0; i < 2; i++) {
+						devices[gpu].BindBuffers(shader, &buffers[i]);
+						devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params);
+					}
+
+					devices[gpu].DownloadDataAsync(buffers[2], results);
+					devices[gpu].NextEpoch();
+
+					// with two regions the previous epoch is still alive, the one before it is gone
+					if (devices[gpu].GetBuffer(handles[epoch]) == nullptr || (epoch > 0 && devices[gpu].GetBuffer(handles[epoch - 1]) != nullptr)) {
+						std::cout << "Failed\n";
+						return -1;
+					}
+				}
+
+				devices[gpu].NextEpoch();
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			// the download was waited on when its epoch was freed
+			std::cout << "Buffer 2 results: " << std::flush;
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != 4.0f) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+
+			delete[] testdata;
+			delete[] results;
+			devices[gpu].SetTransientSize(vkcl::ArenaDefaultSize);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Aliased Buffer Test\n";
+
+			const int STEPS = 6;
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *input, *output;
+			vkcl::CommandList *list;
+			float params[2] = { 2.0f, 0.0f };
+
+			float *testdata = new float[TEST_SIZE];
+			float *results = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = 1.0f;
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				input = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+				output = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+				// step i reads intermediate i - 1 and writes intermediate i, so only neighbours are alive together
+				std::vector<vkcl::AliasedBufferDesc> batch;
+				for (int i = 0; i < STEPS - 1; i++)
+					batch.push_back({ sizeof(float) * TEST_SIZE, (uint32_t)i, (uint32_t)i + 1 });
+
+				// once through separate submissions, once through a command list
+				for (int pass = 0; pass < 2; pass++) {
+					std::vector<vkcl::Buffer *> intermediates = devices[gpu].CreateAliasedBuffers(batch);
+					if (intermediates[0]->devbuffer != intermediates[2]->devbuffer || intermediates[0]->offset != intermediates[2]->offset ||
+					    intermediates[0]->offset == intermediates[1]->offset) {
+						std::cout << "Intermediates were not aliased\n";
+						return -1;
+					}
+
+					std::vector<vkcl::Buffer *> chain = { input };
+					chain.insert(chain.end(), intermediates.begin(), intermediates.end());
+					chain.push_back(output);
+
+					if (pass == 0) {
+						devices[gpu].UploadData(input, testdata);
+						for (int i = 0; i < STEPS; i++) {
+							devices[gpu].BindBuffers(shader, &chain[i]);
+							devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params);
+						}
+						devices[gpu].Wait(devices[gpu].DownloadDataAsync(output, results));
+					} else {
+						list = devices[gpu].CreateCommandList();
+						devices[gpu].RecordUpload(list, input, testdata);
+						for (int i = 0; i < STEPS; i++) {
+							devices[gpu].BindBuffers(shader, &chain[i]);
+							devices[gpu].RecordDispatch(list, shader, TEST_SIZE, 1, 1, params);
+						}
+						devices[gpu].RecordDownload(list, output, results);
+						devices[gpu].Submit(list);
+						devices[gpu].Wait(list);
+						devices[gpu].DeleteCommandList(list);
+					}
+
+					std::cout << "Pass " << pass << " results: " << std::flush;
+					for (int i = 0; i < TEST_SIZE; i++) {
+						if (results[i] != (float)(1 << STEPS)) {
+							std::cout << "Failed\n" << std::flush;
+							return -1;
+						}
+					}
+					std::cout << "Validated" << std::endl;
+
+					for (auto buffer : intermediates)
+						devices[gpu].DeleteBuffer(buffer);
+				}
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			delete[] testdata;
+			delete[] results;
+			devices[gpu].DeleteBuffer(input);
+			devices[gpu].DeleteBuffer(output);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Memory Budget Test\n";
+
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[2];
+			float params[2] = { 3.0f, 0.0f };
+
+			float *testdata = new float[TEST_SIZE];
+			float *results = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = 1.0f;
+
+			try {
+				std::vector<vkcl::HeapBudget> heaps = devices[gpu].GetMemoryBudget();
+				if (heaps.empty() || heaps[0].budget == 0) {
+					std::cout << "No memory budget reported\n";
+					return -1;
+				}
+
+				// with no room at all, fail fast has to refuse the buffer
+				devices[gpu].SetBudgetPolicy(vkcl::BudgetPolicy::FailFast, 0.0f);
+				bool refused = false;
+				try {
+					devices[gpu].CreateBuffer(2 * vkcl::BufferPoolMaxSize);
+				} catch (vkcl::util::Exception &e) {
+					refused = true;
+				}
+				if (!refused) {
+					std::cout << "Buffer was created over budget\n";
+					return -1;
+				}
+
+				// the pool hands out the blocks it already has, but may not grow by another one
+				std::vector<vkcl::Buffer *> pooled;
+				refused = false;
+				for (VkDeviceSize i = 0; i <= 2 * vkcl::BufferPoolBlockSize / vkcl::BufferPoolMaxSize && !refused; i++) {
+					try {
+						pooled.push_back(devices[gpu].CreateBuffer(vkcl::BufferPoolMaxSize));
+					} catch (vkcl::util::Exception &e) {
+						refused = true;
+					}
+				}
+				for (auto buffer : pooled)
+					devices[gpu].DeleteBuffer(buffer);
+				if (!refused) {
+					std::cout << "Buffer pool grew over budget\n";
+					return -1;
+				}
+
+				// neither may the transient arena allocate its regions
+				devices[gpu].SetTransientSize(vkcl::ArenaDefaultSize, vkcl::ArenaDefaultEpochs);
+				refused = false;
+				try {
+					devices[gpu].CreateTransientBuffer(sizeof(float) * TEST_SIZE);
+				} catch (vkcl::util::Exception &e) {
+					refused = true;
+				}
+				if (!refused) {
+					std::cout << "Transient arena was created over budget\n";
+					return -1;
+				}
+
+				// and spilling has to place it in host visible memory that still works with shaders
+				devices[gpu].SetBudgetPolicy(vkcl::BudgetPolicy::Spill, 0.0f);
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				for (int i = 0; i < 2; i++)
+					buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+				devices[gpu].SetBudgetPolicy(vkcl::BudgetPolicy::FailFast);
+
+				VkMemoryPropertyFlags memflags;
+				vmaGetMemoryTypeProperties(devices[gpu].getAllocator(), buffers[0]->devinfo.memoryType, &memflags);
+				if (!(memflags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+					std::cout << "Buffer was not spilled to host memory\n";
+					return -1;
+				}
+
+				devices[gpu].UploadData(buffers[0], testdata);
+				devices[gpu].BindBuffers(shader, buffers);
+				devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params);
+				devices[gpu].Wait(devices[gpu].DownloadDataAsync(buffers[1], results));
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Spilled buffer results: " << std::flush;
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != 3.0f) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+
+			delete[] testdata;
+			delete[] results;
+			for (int i = 0; i < 2; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Memory Usage Test\n";
+
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[2];
+			vkcl::Buffer *local, *automatic;
+			float params[2] = { 4.0f, 0.0f };
+
+			float *testdata = new float[TEST_SIZE];
+			float *results = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = 1.0f;
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				buffers[0] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE, vkcl::MemoryUsage::CPUToGPU);
+				buffers[1] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE, vkcl::MemoryUsage::GPUToCPU);
+				local = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE, vkcl::MemoryUsage::GPUOnly);
+				automatic = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE, vkcl::MemoryUsage::Auto);
+				if (!buffers[0]->mapped || !buffers[1]->mapped || (local->mapped != nullptr) != devices[gpu].getZeroCopySupport()) {
+					std::cout << "Buffers were not mapped as requested\n";
+					return -1;
+				}
+
+				// the input is written through its mapping, the output is read back without a staging copy
+				std::memcpy(buffers[0]->mapped, testdata, sizeof(float) * TEST_SIZE);
+				devices[gpu].BindBuffers(shader, buffers);
+				devices[gpu].Wait(devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params));
+				devices[gpu].Wait(devices[gpu].DownloadDataAsync(buffers[1], results));
+
+				std::cout << "Mapped buffer results: " << std::flush;
+				for (int i = 0; i < TEST_SIZE; i++) {
+					if (results[i] != 4.0f) {
+						std::cout << "Failed\n" << std::flush;
+						return -1;
+					}
+				}
+				std::cout << "Validated" << std::endl;
+
+				// wherever Auto ended up, it has to work like any other buffer
+				vkcl::Buffer *chain[2] = { automatic, local };
+				devices[gpu].UploadData(automatic, testdata);
+				devices[gpu].BindBuffers(shader, chain);
+				devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params);
+				devices[gpu].Wait(devices[gpu].DownloadDataAsync(local, results));
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Auto buffer results: " << std::flush;
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != 4.0f) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+
+			delete[] testdata;
+			delete[] results;
+			for (int i = 0; i < 2; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteBuffer(local);
+			devices[gpu].DeleteBuffer(automatic);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		if (devices[gpu].getZeroCopySupport()) {
+			std::cout << "Zero Copy Test\n";
+
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[2];
+			float params[2] = { 5.0f, 0.0f };
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				for (int i = 0; i < 2; i++)
+					buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+				// pooled buffers included, device local memory is written and read in place
+				float *input = (float *)devices[gpu].Map(buffers[0]);
+				for (int i = 0; i < TEST_SIZE; i++)
+					input[i] = 1.0f;
+				devices[gpu].Unmap(buffers[0]);
+
+				devices[gpu].BindBuffers(shader, buffers);
+				devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params);
+
+				std::cout << "Mapped results: " << std::flush;
+				float *results = (float *)devices[gpu].Map(buffers[1]);
+				for (int i = 0; i < TEST_SIZE; i++) {
+					if (results[i] != 5.0f) {
+						std::cout << "Failed\n" << std::flush;
+						return -1;
+					}
+				}
+				devices[gpu].Unmap(buffers[1]);
+				std::cout << "Validated" << std::endl;
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			for (int i = 0; i < 2; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		if (devices[gpu].getHostImportSupport()) {
+			std::cout << "Host Import Test\n";
+
+			const int TEST_SIZE = 0x11;
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[2];
+			vkcl::Buffer *host;
+			float params[2] = { 6.0f, 0.0f };
+
+			// the input and the results each get their own aligned part of one imported allocation
+			VkDeviceSize alignment = devices[gpu].getHostImportAlignment();
+			VkDeviceSize half = (sizeof(float) * TEST_SIZE + alignment - 1) & ~(alignment - 1);
+			char *raw = (char *)malloc(2 * half + alignment);
+			float *testdata = (float *)(((uintptr_t)raw + alignment - 1) & ~(uintptr_t)(alignment - 1));
+			float *results = (float *)((char *)testdata + half);
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = 1.0f;
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				host = devices[gpu].ImportHostMemory(testdata, 2 * half);
+				for (int i = 0; i < 2; i++)
+					buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+				devices[gpu].UploadDataAsync(buffers[0], testdata);
+
+				// the source can be reused as soon as the upload returns, even when it was imported
+				for (int i = 0; i < TEST_SIZE; i++)
+					testdata[i] = 0.0f;
+
+				devices[gpu].BindBuffers(shader, buffers);
+				devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params);
+				devices[gpu].Wait(devices[gpu].DownloadDataAsync(buffers[1], results));
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Imported results: " << std::flush;
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != 6.0f) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+
+			devices[gpu].DeleteBuffer(host);
+			for (int i = 0; i < 2; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+			free(raw);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Compaction Test\n";
+
+			const int BUFFER_COUNT = 8;
+			const int TEST_SIZE = 0x8000; // too large for the buffer pool
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[BUFFER_COUNT];
+			vkcl::Buffer *output;
+			float params[2] = { 2.0f, 0.0f };
+
+			float *testdata = new float[TEST_SIZE];
+			float *results = new float[TEST_SIZE];
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_scale.spv");
+				output = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+				for (int i = 0; i < BUFFER_COUNT; i++) {
+					for (int j = 0; j < TEST_SIZE; j++)
+						testdata[j] = (float)(i + 1);
+					buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+					devices[gpu].UploadData(buffers[i], testdata);
+				}
+
+				// leave holes for the remaining buffers to move into
+				for (int i = 0; i < BUFFER_COUNT; i += 2)
+					devices[gpu].DeleteBuffer(buffers[i]);
+
+				std::cout << "Reclaimed " << devices[gpu].Compact() << " bytes\n";
+
+				std::cout << "Moved buffer results: " << std::flush;
+				for (int i = 1; i < BUFFER_COUNT; i += 2) {
+					devices[gpu].Wait(devices[gpu].DownloadDataAsync(buffers[i], results));
+					for (int j = 0; j < TEST_SIZE; j++) {
+						if (results[j] != (float)(i + 1)) {
+							std::cout << "Failed\n" << std::flush;
+							return -1;
+						}
+					}
+				}
+				std::cout << "Validated" << std::endl;
+
+				vkcl::Buffer *bound[2] = { buffers[BUFFER_COUNT - 1], output };
+				devices[gpu].BindBuffers(shader, bound);
+				devices[gpu].Submit(shader, TEST_SIZE, 1, 1, params);
+				devices[gpu].Wait(devices[gpu].DownloadDataAsync(output, results));
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Rebound buffer results: " << std::flush;
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != 2.0f * BUFFER_COUNT) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+
+			delete[] testdata;
+			delete[] results;
+			for (int i = 1; i < BUFFER_COUNT; i += 2)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteBuffer(output);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		if (devices[gpu].getBufferAddressSupport()) {
+			std::cout << "Buffer Address Test\n";
+
+			const int BUFFER_COUNT = 3;
+			const int TEST_SIZE = 0x11;
+
+			struct {
+				VkDeviceAddress in;
+				VkDeviceAddress out;
+				float alpha;
+			} params[BUFFER_COUNT - 1];
+
+			vkcl::Shader *shader;
+			vkcl::Buffer *buffers[BUFFER_COUNT];
+
+			float *testdata = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = 1.0f;
+
+			try {
+				shader = devices[gpu].CreateShader("./test/test_address.spv");
+				for (int i = 0; i < BUFFER_COUNT; i++)
+					buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+				devices[gpu].UploadData(buffers[0], testdata);
+
+				// the first step runs again below with the same constants, only the used buffers change
+				vkcl::Buffer *scratch = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+				vkcl::Buffer *used[3] = { buffers[0], buffers[1], scratch };
+				params[0] = { devices[gpu].BufferAddress(buffers[0]), devices[gpu].BufferAddress(buffers[1]), 2.0f };
+				devices[gpu].UseBuffers(shader, used, 3);
+				devices[gpu].Submit(shader, TEST_SIZE, 1, 1, &params[0]);
+				devices[gpu].DeleteBuffer(scratch);
+
+				// no descriptors, each step reads the previous step's output through its address
+				for (int i = 0; i < BUFFER_COUNT - 1; i++) {
+					params[i] = { devices[gpu].BufferAddress(buffers[i]), devices[gpu].BufferAddress(buffers[i + 1]), (float)(i + 2) };
+					devices[gpu].UseBuffers(shader, &buffers[i], 2);
+					devices[gpu].Submit(shader, TEST_SIZE, 1, 1, &params[i]);
+				}
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Buffer " << BUFFER_COUNT - 1 << " results: " << std::flush;
+			float *results = (float *)devices[gpu].DownloadData(buffers[BUFFER_COUNT - 1]);
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (results[i] != 6.0f) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+			devices[gpu].ReleaseData(results);
+
+			delete[] testdata;
+			for (int i = 0; i < BUFFER_COUNT; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			devices[gpu].DeleteShader(shader);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Specialization Constant Test\n";
+
+			const int SHADER_COUNT = 3;
+			const int TEST_SIZE = 0x11;
+			const float factors[SHADER_COUNT] = { 2.0f, 3.0f, 2.0f };
+
+			vkcl::Shader *shaders[SHADER_COUNT];
+			vkcl::Buffer *buffers[2];
+
+			float *testdata = new float[TEST_SIZE];
+			for (int i = 0; i < TEST_SIZE; i++)
+				testdata[i] = (float)i;
+
+			for (int i = 0; i < 2; i++)
+				buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+			try {
+				devices[gpu].UploadData(buffers[0], testdata);
+
+				for (int i = 0; i < SHADER_COUNT; i++) {
+					vkcl::SpecConstant factor = { 0, 0 };
+					std::memcpy(&factor.value, &factors[i], sizeof(float));
+
+					shaders[i] = devices[gpu].CreateShader("./test/test_spec.spv", 2, 0, { factor });
+				}
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			// a workgroup size specialized to 0 can't be dispatched
+			bool rejected = false;
+			try {
+				devices[gpu].CreateShader("./test/test_spec.spv", 2, 0, { { 1, 0 } });
+			} catch (vkcl::util::Exception &e) {
+				std::cout << "Rejected: " << e.getMsg() << std::endl;
+				rejected = true;
+			}
+
+			if (!rejected) {
+				std::cout << "Failed\n";
+				return -1;
+			}
+
+			// equal constants share one pipeline, different ones get their own
+			if (shaders[0]->pipeline != shaders[2]->pipeline || shaders[0]->pipeline == shaders[1]->pipeline || shaders[0]->shadermod != shaders[1]->shadermod) {
+				std::cout << "Failed\n";
+				return -1;
+			}
+
+			for (int i = 0; i < SHADER_COUNT; i++) {
+				std::cout << "Factor " << factors[i] << " results: " << std::flush;
+
+				devices[gpu].BindBuffers(shaders[i], buffers);
+				devices[gpu].RunShader(shaders[i], TEST_SIZE, 1, 1);
+
+				float *results = (float *)devices[gpu].DownloadData(buffers[1]);
+				for (int j = 0; j < TEST_SIZE; j++) {
+					if (results[j] != testdata[j] * factors[i]) {
+						std::cout << "Failed\n" << std::flush;
+						return -1;
+					}
+				}
+				std::cout << "Validated" << std::endl;
+				devices[gpu].ReleaseData(results);
+			}
+
+			delete[] testdata;
+			for (int i = 0; i < 2; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+			for (int i = 0; i < SHADER_COUNT; i++)
+				devices[gpu].DeleteShader(shaders[i]);
+			devices[gpu].TrimShaderVariants();
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Parallel Shader Creation Test\n";
+
+			const int SHADER_COUNT = 8;
+			const int BUFFER_COUNT = 3;
+			const int TEST_SIZE = 0x11;
+
+			std::vector<vkcl::ShaderDesc> batch;
+			for (int i = 0; i < SHADER_COUNT; i++)
+				batch.push_back({ "./test/test_mul.spv", BUFFER_COUNT, 0, {} });
+
+			std::vector<vkcl::Shader *> shaders;
+			vkcl::Buffer *buffers[BUFFER_COUNT];
+
+			for (int i = 0; i < BUFFER_COUNT; i++)
+				buffers[i] = devices[gpu].CreateBuffer(sizeof(float) * TEST_SIZE);
+
+			try {
+				std::future<vkcl::Shader *> pending = devices[gpu].CreateShaderAsync("./test/test_mul.spv", BUFFER_COUNT);
+				shaders = devices[gpu].CreateShaders(batch);
+				shaders.push_back(pending.get());
+
+				// every pipeline in the batch is usable
+				for (auto shader : shaders) {
+					devices[gpu].BindBuffers(shader, buffers);
+					devices[gpu].RunShader(shader, TEST_SIZE, 1, 1);
+				}
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Buffer 2 results: " << std::flush;
+			float *testdata = (float *)devices[gpu].DownloadData(buffers[2]);
+			for (int i = 0; i < TEST_SIZE; i++) {
+				if (testdata[i] != (float)(1 << i)) {
+					std::cout << "Failed\n" << std::flush;
+					return -1;
+				}
+			}
+			std::cout << "Validated" << std::endl;
+			devices[gpu].ReleaseData(testdata);
+
+			// a missing file fails the whole batch
+			batch.push_back({ "./test/missing.spv", BUFFER_COUNT, 0, {} });
+			try {
+				devices[gpu].CreateShaders(batch);
+				std::cout << "Failed\n";
+				return -1;
+			} catch (vkcl::util::Exception &e) {
+			}
+
+			for (auto shader : shaders)
+				devices[gpu].DeleteShader(shader);
+			for (int i = 0; i < BUFFER_COUNT; i++)
+				devices[gpu].DeleteBuffer(buffers[i]);
+
+			std::cout << "Success\n";
+		}
+
+		{
+			std::cout << "Pipeline Cache Test\n";
+
+			const char *cachefile = "./test/pipeline.cache";
+			vkcl::Shader *shader;
+
+			try {
+				// a corrupt file is ignored instead of being handed to the driver
+				FILE *f = fopen(cachefile, "wb");
+				fputs("not a pipeline cache", f);
+				fclose(f);
+				devices[gpu].SetPipelineCacheFile(cachefile);
+
+				shader = devices[gpu].CreateShader("./test/test_mul.spv", 3);
+				devices[gpu].SavePipelineCache();
+				devices[gpu].DeleteShader(shader);
+
+				// the saved cache is picked up again and the pipeline is created from it
+				devices[gpu].SetPipelineCacheFile(cachefile);
+				shader = devices[gpu].CreateShader("./test/test_mul.spv", 3);
+				devices[gpu].DeleteShader(shader);
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			FILE *f = fopen(cachefile, "rb");
+			fseek(f, 0, SEEK_END);
+			long size = ftell(f);
+			fseek(f, 0, SEEK_SET);
+			vkcl::PipelineCacheHeader header;
+			bool read = fread(&header, sizeof(header), 1, f) == 1;
+			fclose(f);
+
+			if (!read || size <= (long)sizeof(vkcl::PipelineCacheHeader)) {
+				std::cout << "Failed\n";
+				return -1;
+			}
+
+			try {
+				// a header claiming more data than the file holds is ignored before anything is allocated for it
+				header.dataSize = UINT64_MAX / 2;
+				f = fopen(cachefile, "wb");
+				fwrite(&header, sizeof(header), 1, f);
+				fclose(f);
+				devices[gpu].SetPipelineCacheFile(cachefile);
+			} catch (vkcl::util::Exception &e) {
+				std::cout << e.getMsg() << std::endl;
+				return -1;
+			}
+
+			std::cout << "Success\n";
+		}
+	}
+
+	printf("Shutting down..\n");
+	for (auto dev : devices) {
+		dev.Delete();
+	}
+
+	return 0;
+}